@@ -0,0 +1,123 @@
+#include <any>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "actions.h"
+
+using namespace Iguana;
+
+Values::Values(std::any* begin, std::size_t count)
+    : mBegin(begin), mCount(count)
+{}
+
+std::size_t Values::size() const {
+    return mCount;
+}
+
+std::any& Values::operator[](std::size_t i) {
+    return mBegin[i];
+}
+
+const Actions::RuleAction* Actions::findRule(const std::string& name) {
+    auto cached = mRuleCache.find(&name);
+    if (cached != mRuleCache.end())
+        return cached->second;
+
+    auto it = mRules.find(name);
+    const RuleAction* action = it != mRules.end() ? &it->second : nullptr;
+    mRuleCache[&name] = action;
+
+    return action;
+}
+
+const Actions::LeafAction* Actions::findLeaf(const std::string& name) {
+    auto cached = mLeafCache.find(&name);
+    if (cached != mLeafCache.end())
+        return cached->second;
+
+    auto it = mLeaves.find(name);
+    const LeafAction* action = it != mLeaves.end() ? &it->second : nullptr;
+    mLeafCache[&name] = action;
+
+    return action;
+}
+
+void Actions::open(const RuleAction* action) {
+    mFrames.push_back(Frame{ mValues.size(), action });
+}
+
+void Actions::push(const LeafAction* action, std::string_view text) {
+    if (action != nullptr)
+        mValues.push_back((*action)(text));
+    else
+        mValues.emplace_back(text);
+}
+
+void Actions::close() {
+    Frame frame = mFrames.back();
+    mFrames.pop_back();
+
+    if (frame.mAction == nullptr)
+        return;
+
+    Values children(mValues.data() + frame.mBase, mValues.size() - frame.mBase);
+    std::any value = (*frame.mAction)(children);
+
+    mValues.resize(frame.mBase);
+    mValues.push_back(std::move(value));
+}
+
+void Actions::enterRule(const std::string& name, std::size_t) {
+    open(findRule(name));
+}
+
+void Actions::leaf(const std::string& name, std::string_view text) {
+    push(findLeaf(name), text);
+}
+
+void Actions::exitRule(const std::string&, std::size_t) {
+    close();
+}
+
+// Walks with a stack of its own: trees grown from left recursion are as
+// deep as the chains they parse.
+void Actions::run(const Node& root) {
+    std::vector<std::pair<const Node*, bool>> stack{ { &root, false } };
+
+    while (!stack.empty()) {
+        auto [node, done] = stack.back();
+        stack.pop_back();
+
+        if (done) {
+            close();
+            continue;
+        }
+
+        mKey.assign(node->mName.data(), node->mName.size());
+        auto rule = mRules.find(mKey);
+        auto leaf = mLeaves.find(mKey);
+
+        if (node->mNodes.empty() && (rule == mRules.end() || leaf != mLeaves.end())) {
+            push(leaf != mLeaves.end() ? &leaf->second : nullptr, node->mValue);
+            continue;
+        }
+
+        open(rule != mRules.end() ? &rule->second : nullptr);
+        stack.emplace_back(node, true);
+
+        for (std::size_t i = node->mNodes.size(); i > 0; i--)
+            stack.emplace_back(&node->mNodes[i - 1], false);
+    }
+}
+
+std::vector<std::any>& Actions::values() {
+    return mValues;
+}
+
+void Actions::clear() {
+    mValues.clear();
+    mFrames.clear();
+    mRuleCache.clear();
+    mLeafCache.clear();
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <any>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "vm.h"
+
+namespace Iguana {
+    // The values the children of a node produced, in order. They are
+    // std::any, so get<T>() throws std::bad_any_cast when T is not the
+    // type the child's action was registered with.
+    class Values {
+    private:
+        std::any* mBegin;
+        std::size_t mCount;
+
+    public:
+        Values(std::any*, std::size_t);
+
+        std::size_t size() const;
+        std::any& operator[](std::size_t);
+
+        template <typename T>
+        T& get(std::size_t i) {
+            return std::any_cast<T&>(mBegin[i]);
+        }
+    };
+
+    // Semantic actions run while parsing, so a parse can produce domain
+    // values without building a tree. Pass an Actions to
+    // Program::parse(CodeTracker*, ParseHandler*).
+    //
+    // A leaf's action gets its text; a leaf without one produces the text
+    // as a std::string_view. A rule's action gets the values of its
+    // children; a rule without one passes them on to its parent. Events
+    // only arrive for nodes no backtracking can undo, so actions never run
+    // for alternatives that fail.
+    //
+    // Program refuses left-recursive grammars. For those, parse with
+    // GlobalParserTable::parse and hand the tree to run().
+    class Actions : public ParseHandler {
+    private:
+        using RuleAction = std::function<std::any(Values&)>;
+        using LeafAction = std::function<std::any(std::string_view)>;
+
+        std::unordered_map<std::string, RuleAction> mRules;
+        std::unordered_map<std::string, LeafAction> mLeaves;
+
+        // Lookups by the rule name's address, which stays put for the life
+        // of a Program, so each name is hashed once. Only valid for the
+        // Program of the current parse; clear() drops them.
+        std::unordered_map<const std::string*, const RuleAction*> mRuleCache;
+        std::unordered_map<const std::string*, const LeafAction*> mLeafCache;
+
+        struct Frame {
+            std::size_t mBase;
+            const RuleAction* mAction;
+        };
+
+        std::vector<std::any> mValues;
+        std::vector<Frame> mFrames;
+
+        // Key for lookups by a name that is not a std::string.
+        std::string mKey;
+
+        const RuleAction* findRule(const std::string&);
+        const LeafAction* findLeaf(const std::string&);
+
+        void open(const RuleAction*);
+        void push(const LeafAction*, std::string_view);
+        void close();
+
+    public:
+        template <typename T, typename F>
+        void onRule(const std::string& name, F fn) {
+            mRules[name] = [fn](Values& v) -> std::any { return std::any(T(fn(v))); };
+            mRuleCache.clear();
+        }
+
+        template <typename T, typename F>
+        void onLeaf(const std::string& name, F fn) {
+            mLeaves[name] = [fn](std::string_view text) -> std::any { return std::any(T(fn(text))); };
+            mLeafCache.clear();
+        }
+
+        void enterRule(const std::string&, std::size_t) override;
+        void leaf(const std::string&, std::string_view) override;
+        void exitRule(const std::string&, std::size_t) override;
+
+        // Runs the actions over a tree as if its nodes had arrived as
+        // events. A node with children is a rule; one without is a leaf,
+        // unless only a rule action is registered under its name.
+        void run(const Node&);
+
+        // Values left once the parse is done: the root's, or those of its
+        // children when the root has no action.
+        std::vector<std::any>& values();
+
+        // Call before each parse after the first, whatever Program it uses.
+        void clear();
+
+        template <typename T>
+        T take() {
+            T value = std::any_cast<T>(std::move(mValues.back()));
+            mValues.pop_back();
+            return value;
+        }
+    };
+}
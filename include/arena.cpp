@@ -0,0 +1,123 @@
+#include <cstdlib>
+#include <new>
+#include "arena.h"
+
+using namespace Iguana;
+
+static const std::size_t MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+
+Arena::Arena(std::size_t initialSize)
+    : mChunks(nullptr), mCur(nullptr), mEnd(nullptr),
+    mNextSize(initialSize), mChunkCount(0), mBytesUsed(0),
+    mParent(nullptr), mAdopted(nullptr), mNextAdopted(nullptr)
+{}
+
+Arena::~Arena() {
+    freeAdopted();
+
+    Chunk* c = mChunks;
+
+    while (c != nullptr) {
+        Chunk* next = c->mNext;
+        std::free(c);
+        c = next;
+    }
+}
+
+void Arena::grow(std::size_t bytes, std::size_t align) {
+    std::size_t needed = sizeof(Chunk) + bytes + align;
+    std::size_t size = mNextSize;
+
+    while (size < needed)
+        size *= 2;
+
+    Chunk* c = static_cast<Chunk*>(std::malloc(size));
+    if (c == nullptr)
+        throw std::bad_alloc();
+
+    c->mNext = mChunks;
+    c->mSize = size;
+    mChunks = c;
+    mCur = reinterpret_cast<char*>(c) + sizeof(Chunk);
+    mEnd = reinterpret_cast<char*>(c) + size;
+    ++mChunkCount;
+
+    if (mNextSize < MAX_CHUNK_SIZE)
+        mNextSize *= 2;
+}
+
+void* Arena::do_allocate(std::size_t bytes, std::size_t align) {
+    std::size_t pad = (align - reinterpret_cast<std::size_t>(mCur) % align) % align;
+
+    if (mCur == nullptr || static_cast<std::size_t>(mEnd - mCur) < pad + bytes) {
+        grow(bytes, align);
+        pad = (align - reinterpret_cast<std::size_t>(mCur) % align) % align;
+    }
+
+    void* res = mCur + pad;
+    mCur += pad + bytes;
+    mBytesUsed += bytes;
+
+    return res;
+}
+
+void Arena::do_deallocate(void*, std::size_t, std::size_t) {}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    if (this == &other)
+        return true;
+
+    const Arena* arena = dynamic_cast<const Arena*>(&other);
+    return arena != nullptr && arena->root() == root();
+}
+
+const Arena* Arena::root() const {
+    const Arena* a = this;
+
+    while (a->mParent != nullptr)
+        a = a->mParent;
+
+    return a;
+}
+
+void Arena::adopt(Arena* other) {
+    other->mParent = this;
+    other->mNextAdopted = mAdopted;
+    mAdopted = other;
+}
+
+void Arena::freeAdopted() {
+    while (mAdopted != nullptr) {
+        Arena* next = mAdopted->mNextAdopted;
+        delete mAdopted;
+        mAdopted = next;
+    }
+}
+
+void Arena::reset() {
+    freeAdopted();
+
+    if (mChunks == nullptr)
+        return;
+
+    Chunk* c = mChunks->mNext;
+    while (c != nullptr) {
+        Chunk* next = c->mNext;
+        std::free(c);
+        c = next;
+    }
+
+    mChunks->mNext = nullptr;
+    mCur = reinterpret_cast<char*>(mChunks) + sizeof(Chunk);
+    mEnd = reinterpret_cast<char*>(mChunks) + mChunks->mSize;
+    mChunkCount = 1;
+    mBytesUsed = 0;
+}
+
+std::size_t Arena::chunkCount() {
+    return mChunkCount;
+}
+
+std::size_t Arena::bytesUsed() {
+    return mBytesUsed;
+}
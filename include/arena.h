@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+namespace Iguana {
+    class Arena : public std::pmr::memory_resource {
+    private:
+        struct Chunk {
+            Chunk* mNext;
+            std::size_t mSize;
+        };
+
+        Chunk* mChunks;
+        char* mCur;
+        char* mEnd;
+        std::size_t mNextSize;
+        std::size_t mChunkCount;
+        std::size_t mBytesUsed;
+
+        // Arenas handed over with adopt(), freed along with this one.
+        Arena* mParent;
+        Arena* mAdopted;
+        Arena* mNextAdopted;
+
+        const Arena* root() const;
+        void freeAdopted();
+        void grow(std::size_t, std::size_t);
+
+        void* do_allocate(std::size_t, std::size_t) override;
+        void do_deallocate(void*, std::size_t, std::size_t) override;
+        bool do_is_equal(const std::pmr::memory_resource&) const noexcept override;
+
+    public:
+        Arena(std::size_t = 64 * 1024);
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        ~Arena();
+
+        // Objects are never destroyed individually, so anything placed in
+        // the arena must either be trivially destructible or take its
+        // memory from the arena through a polymorphic allocator.
+        template <typename T, typename... Args>
+        T* make(Args&&... args) {
+            static_assert(std::is_trivially_destructible<T>::value
+                || std::uses_allocator<T, std::pmr::polymorphic_allocator<char>>::value,
+                "Arena objects must not own memory outside the arena");
+
+            T* obj = static_cast<T*>(allocate(sizeof(T), alignof(T)));
+            std::pmr::polymorphic_allocator<T> alloc(this);
+            alloc.construct(obj, std::forward<Args>(args)...);
+            return obj;
+        }
+
+        void reset();
+
+        // Takes ownership of other, which must not be adopted elsewhere.
+        // Arenas that share an owner compare equal, so containers move
+        // between them without copying; nothing is freed individually, so
+        // that is safe for as long as the owner lives.
+        void adopt(Arena*);
+
+        std::size_t chunkCount();
+        std::size_t bytesUsed();
+    };
+}
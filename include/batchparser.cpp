@@ -0,0 +1,38 @@
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "batchparser.h"
+#include "frozengrammar.h"
+#include "context.h"
+
+using namespace Iguana;
+
+BatchParser::BatchParser(const FrozenGrammar* grammar, unsigned int threads)
+    : mGrammar(grammar), mPool(threads)
+{
+    for (std::size_t i = 0; i < mPool.threads(); i++)
+        mContexts.emplace_back(new ParseContext());
+}
+
+BatchParser::~BatchParser() = default;
+
+std::size_t BatchParser::threads() const {
+    return mPool.threads();
+}
+
+std::vector<ParseResult*> BatchParser::parse(const std::vector<std::string_view>& docs) {
+    std::vector<ParseResult*> results(docs.size(), nullptr);
+
+    try {
+        mPool.run(docs.size(), [&](std::size_t worker, std::size_t idx) {
+            results[idx] = mGrammar->parse(docs[idx], mContexts[worker].get());
+        });
+    } catch (...) {
+        for (ParseResult* res : results)
+            delete res;
+
+        throw;
+    }
+
+    return results;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "iguana.h"
+#include "workerpool.h"
+
+namespace Iguana {
+    class FrozenGrammar;
+    class ParseContext;
+
+    // Parses batches of documents with one FrozenGrammar on a WorkerPool
+    // that lives as long as the BatchParser. Each pool thread keeps its own
+    // ParseContext.
+    class BatchParser {
+    private:
+        const FrozenGrammar* mGrammar;
+        WorkerPool mPool;
+        std::vector<std::unique_ptr<ParseContext>> mContexts;
+
+    public:
+        // threads = 0 uses one per hardware thread. The calling thread
+        // counts as one of them.
+        BatchParser(const FrozenGrammar*, unsigned int = 0);
+        BatchParser(const BatchParser&) = delete;
+        BatchParser& operator=(const BatchParser&) = delete;
+        ~BatchParser();
+
+        // Returns one result per document, in the same order; the caller
+        // owns them. Documents must outlive their results.
+        std::vector<ParseResult*> parse(const std::vector<std::string_view>&);
+
+        std::size_t threads() const;
+    };
+}
@@ -0,0 +1,226 @@
+#include <cstddef>
+#include <string_view>
+#include "charclass.h"
+#include "scan.h"
+
+using namespace Iguana;
+
+static int hexValue(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+static bool shorthand(char ch, CharClass& out) {
+    switch (ch) {
+        case 'd': out = CharClass::digit(); return true;
+        case 'w': out = CharClass::word(); return true;
+        case 's': out = CharClass::space(); return true;
+        case 'D': out = ~CharClass::digit(); return true;
+        case 'W': out = ~CharClass::word(); return true;
+        case 'S': out = ~CharClass::space(); return true;
+        default: return false;
+    }
+}
+
+// Reads one byte at spec[pos] (after the backslash if escaped). Returns -1
+// on a truncated escape.
+static int escapedByte(std::string_view spec, std::size_t& pos) {
+    if (pos >= spec.length())
+        return -1;
+
+    char ch = spec[pos++];
+
+    switch (ch) {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        case '0': return '\0';
+        case 'x': {
+            if (pos + 2 > spec.length())
+                return -1;
+
+            int hi = hexValue(spec[pos]);
+            int lo = hexValue(spec[pos + 1]);
+            if (hi < 0 || lo < 0)
+                return -1;
+
+            pos += 2;
+            return hi * 16 + lo;
+        }
+        default: return static_cast<unsigned char>(ch);
+    }
+}
+
+CharClass::CharClass()
+    : mValid(true)
+{}
+
+CharClass::CharClass(std::string_view spec)
+    : mValid(false)
+{
+    std::size_t pos = 0;
+
+    if (!parseTerm(spec, pos))
+        return;
+
+    while (pos < spec.length() && spec[pos] == '|') {
+        ++pos;
+        if (!parseTerm(spec, pos))
+            return;
+    }
+
+    mValid = pos == spec.length();
+}
+
+bool CharClass::parseTerm(std::string_view spec, std::size_t& pos) {
+    if (pos >= spec.length())
+        return false;
+
+    if (spec[pos] == '[')
+        return parseBracket(spec, pos);
+
+    CharClass cls;
+    if (spec[pos] == '\\' && pos + 1 < spec.length() && shorthand(spec[pos + 1], cls)) {
+        pos += 2;
+        *this |= cls;
+        return true;
+    }
+
+    return false;
+}
+
+bool CharClass::parseBracket(std::string_view spec, std::size_t& pos) {
+    ++pos;
+
+    bool negate = pos < spec.length() && spec[pos] == '^';
+    if (negate)
+        ++pos;
+
+    CharClass group;
+
+    while (true) {
+        if (pos >= spec.length())
+            return false;
+
+        char ch = spec[pos];
+
+        if (ch == ']')
+            break;
+
+        int lo;
+
+        if (ch == '\\') {
+            ++pos;
+            CharClass cls;
+            if (pos < spec.length() && shorthand(spec[pos], cls)) {
+                ++pos;
+                group |= cls;
+                continue;
+            }
+
+            lo = escapedByte(spec, pos);
+            if (lo < 0)
+                return false;
+        } else {
+            lo = static_cast<unsigned char>(ch);
+            ++pos;
+        }
+
+        if (pos + 1 < spec.length() && spec[pos] == '-' && spec[pos + 1] != ']') {
+            ++pos;
+            int hi;
+
+            if (spec[pos] == '\\') {
+                ++pos;
+                hi = escapedByte(spec, pos);
+            } else {
+                hi = static_cast<unsigned char>(spec[pos++]);
+            }
+
+            if (hi < lo)
+                return false;
+
+            group.mSet.setRange(lo, hi);
+        } else {
+            group.mSet.set(lo);
+        }
+    }
+
+    ++pos;
+
+    if (negate)
+        group.mSet.invert();
+
+    *this |= group;
+    return true;
+}
+
+CharClass CharClass::members(std::string_view chars) {
+    CharClass cls;
+    cls.mSet = ByteSet(chars);
+    return cls;
+}
+
+CharClass CharClass::range(unsigned char lo, unsigned char hi) {
+    CharClass cls;
+    cls.mSet.setRange(lo, hi);
+    return cls;
+}
+
+CharClass CharClass::alpha() {
+    return range('a', 'z') | range('A', 'Z');
+}
+
+CharClass CharClass::digit() {
+    return range('0', '9');
+}
+
+CharClass CharClass::alnum() {
+    return alpha() | digit();
+}
+
+CharClass CharClass::word() {
+    return alnum() | members("_");
+}
+
+CharClass CharClass::space() {
+    return members(" \t\n\v\f\r");
+}
+
+CharClass& CharClass::operator|=(const CharClass& other) {
+    mSet.merge(other.mSet);
+    mValid = mValid && other.mValid;
+    return *this;
+}
+
+CharClass CharClass::operator|(const CharClass& other) const {
+    CharClass res = *this;
+    res |= other;
+    return res;
+}
+
+CharClass CharClass::operator~() const {
+    CharClass res = *this;
+    res.mSet.invert();
+    return res;
+}
+
+bool CharClass::valid() const {
+    return mValid;
+}
+
+bool CharClass::contains(unsigned char b) const {
+    return mSet.test(b);
+}
+
+std::size_t CharClass::scan(const char* begin, const char* end) const {
+    return scanSet(begin, end, mSet);
+}
+
+const ByteSet& CharClass::set() const {
+    return mSet;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include "scan.h"
+
+namespace Iguana {
+    // A set of bytes compiled once into a 256-bit lookup bitmap.
+    //
+    // Specs are one or more bracket expressions joined by '|', e.g.
+    // "[a-zA-Z_]|[0-9]" or "[^\"\\n]". Inside brackets: ranges "a-z", a
+    // leading '^' to negate, escapes \n \t \r \f \v \0 \xHH and the shorthand
+    // classes \d \w \s (\D \W \S negated), which may also stand alone
+    // outside brackets. A '-' at either end is literal; ']' must be escaped.
+    class CharClass {
+    private:
+        ByteSet mSet;
+        bool mValid;
+
+        bool parseTerm(std::string_view, std::size_t&);
+        bool parseBracket(std::string_view, std::size_t&);
+
+    public:
+        CharClass();
+        CharClass(std::string_view);
+
+        static CharClass members(std::string_view);
+        static CharClass range(unsigned char, unsigned char);
+        static CharClass alpha();
+        static CharClass digit();
+        static CharClass alnum();
+        static CharClass word();
+        static CharClass space();
+
+        CharClass& operator|=(const CharClass&);
+        CharClass operator|(const CharClass&) const;
+        CharClass operator~() const;
+
+        bool valid() const;
+        bool contains(unsigned char) const;
+        std::size_t scan(const char*, const char*) const;
+        const ByteSet& set() const;
+    };
+}
@@ -1,127 +1,129 @@
 #include "codetracker.h"
+#include "compiledregex.h"
+#include "lineindex.h"
+#include "scan.h"
+#include "charclass.h"
 
 #include <string>
-#include <regex>
 #include <iostream>
 
 CodeTracker::CodeTracker(std::string* code) {
     mCode = code;
     mIdx = 0;
-    mLin = 1;
-    mCol = 1;
+    mCtx = nullptr;
+    mLines = std::make_shared<Iguana::LineIndex>(code);
+    mReach = 0;
+}
+
+CodeTracker::CodeTracker(std::string_view code) {
+    mCode = nullptr;
+    mView = code;
+    mIdx = 0;
+    mCtx = nullptr;
+    mLines = std::make_shared<Iguana::LineIndex>(code);
+    mReach = 0;
 }
 
 CodeTracker* CodeTracker::copy() {
-    CodeTracker* newTracker = new CodeTracker(mCode);
+    CodeTracker* newTracker = mCode != nullptr ? new CodeTracker(mCode) : new CodeTracker(mView);
     newTracker->mIdx = this->mIdx;
-    newTracker->mLin = this->mLin;
-    newTracker->mCol = this->mCol;
+    newTracker->mCtx = this->mCtx;
+    newTracker->mLines = this->mLines;
+    newTracker->mReach = this->mReach;
 
     return newTracker;
 }
 
 void CodeTracker::skipWhitespace() {
-    int len = mCode->length();
-
-    while (mIdx < len) {
-        char ch = mCode->at(mIdx);
-
-        if (!isspace(ch)) break;
-
-        if (ch == '\n') {
-            mLin++;
-            mCol = 1;
-        } else {
-            mCol++;
-        }
-
-        mIdx++;
-    }
+    std::string_view code = input();
+    mIdx += Iguana::scanWhitespace(code.data() + mIdx, code.data() + code.length());
+    touch(mIdx);
 }
 
 bool CodeTracker::matchString(std::string const& toMatch) {
     this->skipWhitespace();
 
-    std::string match = mCode->substr(mIdx, toMatch.length());
+    if (!toMatch.empty())
+        touch(mIdx + toMatch.length() - 1);
 
-    return  match == toMatch;
+    return input().compare(mIdx, toMatch.length(), toMatch) == 0;
 }
 
-void CodeTracker::consume(std::string const& toConsume) {
-    int len = toConsume.length();
-    mIdx += len;
-    mCol += len;
+void CodeTracker::consume(std::string_view toConsume) {
+    mIdx += toConsume.length();
 }
 
-bool CodeTracker::isEOF() {
-    this->skipWhitespace();
+std::string_view CodeTracker::view(std::size_t len) {
+    return input().substr(mIdx, len);
+}
 
-    return mIdx >= mCode->length();
+std::string_view CodeTracker::input() const {
+    return mCode != nullptr ? std::string_view(*mCode) : mView;
 }
 
-std::string CodeTracker::parseKey(int (*key)(int)) {
+bool CodeTracker::isEOF() {
     this->skipWhitespace();
-    std::string res = "";
 
-    int len = mCode->length();
+    return mIdx >= input().length();
+}
 
-    while (mIdx < len && key(mCode->at(mIdx)) != 0) {
-        res += mCode->at(mIdx);
-        mIdx++;
-        mCol++;
-    }
+void CodeTracker::touch(std::size_t offset) {
+    if (offset > mReach)
+        mReach = offset;
+}
 
-    return res;
+std::size_t CodeTracker::line() {
+    return mLines->line(mIdx);
 }
 
-std::string CodeTracker::parseCustomSymbols(std::string& toParse) {
-    this->skipWhitespace();
-    std::string res = "";
+std::size_t CodeTracker::col() {
+    return mLines->col(mIdx);
+}
 
-    int len = mCode->length();
+std::string_view CodeTracker::parseKey(std::size_t (*scan)(const char*, const char*)) {
+    this->skipWhitespace();
 
-    while (mIdx < len && toParse.find(mCode->at(mIdx)) != std::string::npos) {
-        res += mCode->at(mIdx);
-        mIdx++;
-        mCol++;
-    }
+    std::string_view code = input();
+    const char* begin = code.data() + mIdx;
+    std::size_t len = scan(begin, code.data() + code.length());
+    mIdx += len;
+    touch(mIdx);
 
-    return res;
+    return std::string_view(begin, len);
 }
 
-std::string CodeTracker::parseAnything() {
+std::string_view CodeTracker::parseClass(const Iguana::CharClass& cls) {
     this->skipWhitespace();
-    std::string res = "";
 
-    int len = mCode->length();
+    std::string_view code = input();
+    const char* begin = code.data() + mIdx;
+    std::size_t len = cls.scan(begin, code.data() + code.length());
+    mIdx += len;
+    touch(mIdx);
 
-    while (mIdx < len && !isspace(mCode->at(mIdx))) {
-        res += mCode->at(mIdx);
-        mIdx++;
-        mCol++;
-    }
+    return std::string_view(begin, len);
+}
 
-    return res;
+std::string_view CodeTracker::parseAnything() {
+    return parseKey(Iguana::scanNonWhitespace);
 }
 
-std::string CodeTracker::parseRegex(const std::string regx) {
+std::string_view CodeTracker::parseRegex(const Iguana::CompiledRegex& regx) {
     this->skipWhitespace();
 
-    if (mIdx >= mCode->length())
+    std::string_view code = input();
+    if (mIdx >= code.length())
         return "";
 
-    std::string toSearch = mCode->substr(mIdx, std::string::npos);
+    const char* begin = code.data() + mIdx;
+    const char* stop;
+    std::size_t len = regx.match(begin, code.data() + code.length(), &stop);
+    touch(stop - code.data());
 
-    std::regex r(regx);
-    std::smatch m;
-
-    if (!std::regex_search(toSearch, m, r))
-        return "";
-
-    if (m.position(0) != 0)
+    if (len == Iguana::CompiledRegex::npos)
         return "";
 
-    std::string res = m.str(0);
+    std::string_view res(begin, len);
 
     this->consume(res);
 
@@ -130,12 +132,18 @@ std::string CodeTracker::parseRegex(const std::string regx) {
 
 void CodeTracker::display() {
     std::cout << "Index " << mIdx << std::endl;
-    std::cout << "Col   " << mCol << std::endl;
-    std::cout << "Lin   " << mLin << std::endl;
+    std::cout << "Col   " << col() << std::endl;
+    std::cout << "Lin   " << line() << std::endl;
 }
 
 void CodeTracker::copyInfo(CodeTracker* other) {
-    mLin = other->mLin;
-    mCol = other->mCol;
     mIdx = other->mIdx;
 }
+
+CodeTracker::Checkpoint CodeTracker::save() const {
+    return Checkpoint{ mIdx };
+}
+
+void CodeTracker::restore(const Checkpoint& cp) {
+    mIdx = cp.mIdx;
+}
@@ -1,26 +1,56 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <string_view>
 
+namespace Iguana {
+    class ParseContext;
+    class CompiledRegex;
+    class LineIndex;
+    class CharClass;
+}
+
+// Reads either a std::string, which may keep growing while the tracker is in
+// use, or a fixed view over memory owned elsewhere such as a mapped file.
 class CodeTracker {
 private:
     std::string* mCode;
+    std::string_view mView;
 
 public:
-    int mIdx;
-    int mLin;
-    int mCol;
+    struct Checkpoint {
+        std::size_t mIdx;
+    };
+
+    std::size_t mIdx;
+    Iguana::ParseContext* mCtx;
+    std::shared_ptr<Iguana::LineIndex> mLines;
+
+    // Farthest offset any scan has looked at; the input length once a scan
+    // ran into the end. Streaming input uses it to tell whether a parse
+    // could have gone differently with more bytes.
+    std::size_t mReach;
 
     CodeTracker(std::string*);
+    CodeTracker(std::string_view);
     CodeTracker* copy();
     void skipWhitespace();
     bool matchString(std::string const& toMatch);
-    void consume(std::string const& toConsume);
-    std::string parseKey(int (*)(int));
-    std::string parseCustomSymbols(std::string&);
-    std::string parseAnything();
-    std::string parseRegex(const std::string);
+    void consume(std::string_view toConsume);
+    std::string_view view(std::size_t);
+    std::string_view input() const;
+    std::string_view parseKey(std::size_t (*)(const char*, const char*));
+    std::string_view parseClass(const Iguana::CharClass&);
+    std::string_view parseAnything();
+    std::string_view parseRegex(const Iguana::CompiledRegex&);
     bool isEOF();
+    void touch(std::size_t);
+    std::size_t line();
+    std::size_t col();
     void display();
     void copyInfo(CodeTracker*);
+    Checkpoint save() const;
+    void restore(const Checkpoint&);
 };
@@ -0,0 +1,755 @@
+#include <bitset>
+#include <cctype>
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+#include "compiledregex.h"
+
+using namespace Iguana;
+
+static const std::size_t MAX_PROGRAM_SIZE = 20000;
+static const std::size_t MAX_DFA_CELLS = 1 << 20;
+
+struct CompiledRegex::Re {
+    enum class Kind : char {
+        Empty,
+        Set,
+        Cat,
+        Alt,
+        Repeat,
+        Bol,
+    };
+
+    Kind mKind;
+    int mSet;
+    std::vector<Re> mKids;
+    int mMin;
+    int mMax;
+    bool mGreedy;
+
+    Re(Kind kind)
+        : mKind(kind), mSet(-1), mMin(0), mMax(0), mGreedy(true)
+    {}
+};
+
+// Recursive descent over the ECMAScript subset the automaton handles.
+// Anything outside of it (anchors other than a leading '^', backreferences,
+// lookahead, word boundaries, ...) clears mOk and the caller falls back to
+// std::regex.
+class CompiledRegex::Syntax {
+private:
+    const std::string& mPat;
+    std::size_t mPos;
+    std::vector<std::bitset<256>>& mSets;
+
+    bool eof() {
+        return mPos >= mPat.length();
+    }
+
+    char current() {
+        return mPat[mPos];
+    }
+
+    int addSet(const std::bitset<256>& set) {
+        mSets.push_back(set);
+        return mSets.size() - 1;
+    }
+
+    static std::bitset<256> classOf(char esc) {
+        std::bitset<256> set;
+
+        for (int c = 0; c < 256; c++) {
+            bool in = false;
+            switch (std::tolower(esc)) {
+                case 'd':
+                    in = c >= '0' && c <= '9';
+                    break;
+
+                case 'w':
+                    in = std::isalnum(c) || c == '_';
+                    break;
+
+                case 's':
+                    in = c == ' ' || (c >= '\t' && c <= '\r');
+                    break;
+            }
+
+            set[c] = in;
+        }
+
+        if (std::isupper(esc))
+            set.flip();
+
+        return set;
+    }
+
+    bool parseEscape(std::bitset<256>& set, bool& isClass) {
+        if (eof()) {
+            mOk = false;
+            return false;
+        }
+
+        char ch = current();
+        ++mPos;
+        isClass = false;
+
+        switch (ch) {
+            case 'd': case 'D': case 'w': case 'W': case 's': case 'S':
+                set |= classOf(ch);
+                isClass = true;
+                return true;
+
+            case 'n': set.set('\n'); return true;
+            case 't': set.set('\t'); return true;
+            case 'r': set.set('\r'); return true;
+            case 'f': set.set('\f'); return true;
+            case 'v': set.set('\v'); return true;
+
+            case 'x': {
+                if (mPos + 2 > mPat.length()
+                        || !std::isxdigit(mPat[mPos])
+                        || !std::isxdigit(mPat[mPos + 1])) {
+                    mOk = false;
+                    return false;
+                }
+
+                int val = std::stoi(mPat.substr(mPos, 2), nullptr, 16);
+                mPos += 2;
+                set.set(val);
+                return true;
+            }
+        }
+
+        if (std::isalnum(static_cast<unsigned char>(ch))) {
+            mOk = false;
+            return false;
+        }
+
+        set.set(static_cast<unsigned char>(ch));
+        return true;
+    }
+
+    Re parseClass() {
+        std::bitset<256> set;
+        bool negate = false;
+
+        if (!eof() && current() == '^') {
+            negate = true;
+            ++mPos;
+        }
+
+        while (mOk && !eof() && current() != ']') {
+            std::bitset<256> lo;
+            bool loIsClass = false;
+
+            char ch = current();
+            ++mPos;
+
+            if (ch == '\\')
+                parseEscape(lo, loIsClass);
+            else
+                lo.set(static_cast<unsigned char>(ch));
+
+            if (!mOk)
+                break;
+
+            if (mPos + 1 < mPat.length() && current() == '-' && mPat[mPos + 1] != ']') {
+                ++mPos;
+                std::bitset<256> hi;
+                bool hiIsClass = false;
+                char hch = current();
+                ++mPos;
+
+                if (hch == '\\')
+                    parseEscape(hi, hiIsClass);
+                else
+                    hi.set(static_cast<unsigned char>(hch));
+
+                if (!mOk || loIsClass || hiIsClass) {
+                    mOk = false;
+                    break;
+                }
+
+                int from = 0;
+                int to = 0;
+                for (int c = 0; c < 256; c++) {
+                    if (lo[c]) from = c;
+                    if (hi[c]) to = c;
+                }
+
+                if (from > to) {
+                    mOk = false;
+                    break;
+                }
+
+                for (int c = from; c <= to; c++)
+                    set.set(c);
+
+                continue;
+            }
+
+            set |= lo;
+        }
+
+        if (eof()) {
+            mOk = false;
+            return Re(Re::Kind::Empty);
+        }
+
+        ++mPos;
+
+        if (negate)
+            set.flip();
+
+        Re re(Re::Kind::Set);
+        re.mSet = addSet(set);
+        return re;
+    }
+
+    static bool nullable(const Re& re) {
+        switch (re.mKind) {
+            case Re::Kind::Set:
+                return false;
+
+            case Re::Kind::Cat:
+                for (const Re& kid : re.mKids) {
+                    if (!nullable(kid))
+                        return false;
+                }
+                return true;
+
+            case Re::Kind::Alt:
+                for (const Re& kid : re.mKids) {
+                    if (nullable(kid))
+                        return true;
+                }
+                return false;
+
+            case Re::Kind::Repeat:
+                return re.mMin == 0 || nullable(re.mKids[0]);
+
+            default:
+                return true;
+        }
+    }
+
+    bool parseInt(int& val) {
+        std::size_t start = mPos;
+        while (!eof() && std::isdigit(static_cast<unsigned char>(current())))
+            ++mPos;
+
+        if (start == mPos)
+            return false;
+
+        val = std::stoi(mPat.substr(start, mPos - start));
+        return true;
+    }
+
+    Re parseAtom() {
+        char ch = current();
+        ++mPos;
+
+        switch (ch) {
+            case '(': {
+                if (!eof() && current() == '?') {
+                    if (mPos + 1 < mPat.length() && mPat[mPos + 1] == ':') {
+                        mPos += 2;
+                    } else {
+                        mOk = false;
+                        return Re(Re::Kind::Empty);
+                    }
+                }
+
+                Re inner = parseAlt();
+
+                if (eof() || current() != ')') {
+                    mOk = false;
+                    return inner;
+                }
+
+                ++mPos;
+                return inner;
+            }
+
+            case '[':
+                return parseClass();
+
+            case '.': {
+                std::bitset<256> set;
+                set.set();
+                set.reset('\n');
+                set.reset('\r');
+
+                Re re(Re::Kind::Set);
+                re.mSet = addSet(set);
+                return re;
+            }
+
+            case '^':
+                return Re(Re::Kind::Bol);
+
+            case '\\': {
+                std::bitset<256> set;
+                bool isClass;
+                parseEscape(set, isClass);
+
+                Re re(Re::Kind::Set);
+                re.mSet = addSet(set);
+                return re;
+            }
+
+            case '$': case ')': case ']': case '}':
+            case '*': case '+': case '?': case '{':
+                mOk = false;
+                return Re(Re::Kind::Empty);
+        }
+
+        std::bitset<256> set;
+        set.set(static_cast<unsigned char>(ch));
+
+        Re re(Re::Kind::Set);
+        re.mSet = addSet(set);
+        return re;
+    }
+
+    Re parseRepeat() {
+        Re atom = parseAtom();
+
+        while (mOk && !eof()) {
+            int min = 0;
+            int max = -1;
+            char ch = current();
+
+            if (ch == '*') {
+                ++mPos;
+            } else if (ch == '+') {
+                min = 1;
+                ++mPos;
+            } else if (ch == '?') {
+                max = 1;
+                ++mPos;
+            } else if (ch == '{') {
+                ++mPos;
+                if (!parseInt(min)) {
+                    mOk = false;
+                    break;
+                }
+
+                max = min;
+                if (!eof() && current() == ',') {
+                    ++mPos;
+                    if (!parseInt(max))
+                        max = -1;
+                }
+
+                if (eof() || current() != '}' || (max != -1 && max < min)) {
+                    mOk = false;
+                    break;
+                }
+
+                ++mPos;
+            } else {
+                break;
+            }
+
+            Re rep(Re::Kind::Repeat);
+            rep.mMin = min;
+            rep.mMax = max;
+
+            if (!eof() && current() == '?') {
+                rep.mGreedy = false;
+                ++mPos;
+            }
+
+            // libstdc++ has its own rules for loops whose body can match
+            // the empty string; leave those to std::regex.
+            if (rep.mMin != rep.mMax && nullable(atom)) {
+                mOk = false;
+                break;
+            }
+
+            rep.mKids.push_back(std::move(atom));
+            atom = std::move(rep);
+        }
+
+        return atom;
+    }
+
+    Re parseCat() {
+        Re cat(Re::Kind::Cat);
+
+        while (mOk && !eof() && current() != '|' && current() != ')')
+            cat.mKids.push_back(parseRepeat());
+
+        return cat;
+    }
+
+public:
+    bool mOk;
+
+    Syntax(const std::string& pat, std::vector<std::bitset<256>>& sets)
+        : mPat(pat), mPos(0), mSets(sets), mOk(true)
+    {}
+
+    Re parseAlt() {
+        Re alt(Re::Kind::Alt);
+        alt.mKids.push_back(parseCat());
+
+        while (mOk && !eof() && current() == '|') {
+            ++mPos;
+            alt.mKids.push_back(parseCat());
+        }
+
+        return alt;
+    }
+
+    Re parse() {
+        Re re = parseAlt();
+
+        if (!eof())
+            mOk = false;
+
+        return re;
+    }
+};
+
+CompiledRegex::CompiledRegex(const std::string& pattern)
+    : mStart(-1), mSupported(false), mUseDfa(false)
+{
+    Syntax syntax(pattern, mSets);
+    Re re = syntax.parse();
+
+    if (syntax.mOk) {
+        emit(re);
+        mProg.push_back(Inst{ Op::Match, 0, 0 });
+        mSupported = mProg.size() <= MAX_PROGRAM_SIZE;
+    }
+
+    if (!mSupported) {
+        mProg.clear();
+        mSets.clear();
+        mFallback.reset(new std::regex(pattern));
+        return;
+    }
+
+    computeByteClasses();
+    mUseDfa = buildDfa();
+}
+
+void CompiledRegex::emit(const Re& re) {
+    if (mProg.size() > MAX_PROGRAM_SIZE)
+        return;
+
+    switch (re.mKind) {
+        case Re::Kind::Empty:
+            break;
+
+        case Re::Kind::Set:
+            mProg.push_back(Inst{ Op::Char, re.mSet, 0 });
+            break;
+
+        case Re::Kind::Bol:
+            mProg.push_back(Inst{ Op::Bol, 0, 0 });
+            break;
+
+        case Re::Kind::Cat:
+            for (const Re& kid : re.mKids)
+                emit(kid);
+            break;
+
+        case Re::Kind::Alt: {
+            std::vector<int> jumps;
+
+            for (std::size_t i = 0; i + 1 < re.mKids.size(); i++) {
+                int split = mProg.size();
+                mProg.push_back(Inst{ Op::Split, split + 1, 0 });
+                emit(re.mKids[i]);
+                jumps.push_back(mProg.size());
+                mProg.push_back(Inst{ Op::Jmp, 0, 0 });
+                mProg[split].mY = mProg.size();
+            }
+
+            emit(re.mKids.back());
+
+            for (int j : jumps)
+                mProg[j].mX = mProg.size();
+            break;
+        }
+
+        case Re::Kind::Repeat: {
+            const Re& kid = re.mKids[0];
+
+            for (int i = 0; i < re.mMin; i++)
+                emit(kid);
+
+            if (re.mMax == -1) {
+                int loop = mProg.size();
+                mProg.push_back(Inst{ Op::Split, 0, 0 });
+                emit(kid);
+                mProg.push_back(Inst{ Op::Jmp, loop, 0 });
+
+                int body = loop + 1;
+                int out = mProg.size();
+                mProg[loop].mX = re.mGreedy ? body : out;
+                mProg[loop].mY = re.mGreedy ? out : body;
+                break;
+            }
+
+            std::vector<int> splits;
+            for (int i = re.mMin; i < re.mMax; i++) {
+                splits.push_back(mProg.size());
+                mProg.push_back(Inst{ Op::Split, 0, 0 });
+                emit(kid);
+            }
+
+            int out = mProg.size();
+            for (int split : splits) {
+                mProg[split].mX = re.mGreedy ? split + 1 : out;
+                mProg[split].mY = re.mGreedy ? out : split + 1;
+            }
+            break;
+        }
+    }
+}
+
+void CompiledRegex::computeByteClasses() {
+    std::vector<int> cls(256, 0);
+    int count = 1;
+
+    for (const std::bitset<256>& set : mSets) {
+        std::map<std::pair<int, bool>, int> remap;
+        count = 0;
+
+        for (int c = 0; c < 256; c++) {
+            std::pair<int, bool> key(cls[c], set[c]);
+            auto it = remap.find(key);
+
+            if (it == remap.end())
+                it = remap.emplace(key, count++).first;
+
+            cls[c] = it->second;
+        }
+    }
+
+    mClassRep.assign(count, 0);
+    for (int c = 255; c >= 0; c--) {
+        mByteClass[c] = cls[c];
+        mClassRep[cls[c]] = c;
+    }
+}
+
+void CompiledRegex::closure(std::vector<int>& list, std::vector<bool>& visited, int pc, bool atStart) const {
+    std::vector<int> stack{ pc };
+
+    while (!stack.empty()) {
+        int cur = stack.back();
+        stack.pop_back();
+
+        if (visited[cur])
+            continue;
+
+        visited[cur] = true;
+        const Inst& inst = mProg[cur];
+
+        switch (inst.mOp) {
+            case Op::Char:
+            case Op::Match:
+                list.push_back(cur);
+                break;
+
+            case Op::Jmp:
+                stack.push_back(inst.mX);
+                break;
+
+            case Op::Split:
+                stack.push_back(inst.mY);
+                stack.push_back(inst.mX);
+                break;
+
+            case Op::Bol:
+                if (atStart)
+                    stack.push_back(cur + 1);
+                break;
+        }
+    }
+}
+
+// Threads are kept in priority order. Once a Match is reached every lower
+// priority thread can only produce a less preferred match, so it is cut;
+// this gives the same leftmost-first result as a backtracking matcher.
+void CompiledRegex::cutAfterMatch(std::vector<int>& list) const {
+    for (std::size_t i = 0; i < list.size(); i++) {
+        if (mProg[list[i]].mOp == Op::Match) {
+            list.resize(i + 1);
+            return;
+        }
+    }
+}
+
+std::vector<int> CompiledRegex::startList() const {
+    std::vector<int> list;
+    std::vector<bool> visited(mProg.size(), false);
+
+    closure(list, visited, 0, true);
+    cutAfterMatch(list);
+
+    return list;
+}
+
+std::vector<int> CompiledRegex::step(const std::vector<int>& list, unsigned char ch) const {
+    std::vector<int> next;
+    std::vector<bool> visited(mProg.size(), false);
+
+    for (int pc : list) {
+        const Inst& inst = mProg[pc];
+
+        if (inst.mOp == Op::Char && mSets[inst.mX][ch])
+            closure(next, visited, pc + 1, false);
+    }
+
+    cutAfterMatch(next);
+    return next;
+}
+
+bool CompiledRegex::buildDfa() {
+    std::map<std::vector<int>, int> ids;
+    std::vector<std::vector<int>> states;
+    int numClasses = mClassRep.size();
+
+    std::vector<int> start = startList();
+    ids.emplace(start, 0);
+    states.push_back(start);
+
+    for (std::size_t s = 0; s < states.size(); s++) {
+        if ((s + 1) * numClasses > MAX_DFA_CELLS) {
+            mTrans.clear();
+            mAccepting.clear();
+            mFinal.clear();
+            return false;
+        }
+
+        std::vector<int> cur = states[s];
+        bool accepting = !cur.empty() && mProg[cur.back()].mOp == Op::Match;
+
+        mAccepting.push_back(accepting);
+        mFinal.push_back(accepting && cur.size() == 1);
+
+        for (int c = 0; c < numClasses; c++) {
+            std::vector<int> next = step(cur, mClassRep[c]);
+
+            if (next.empty()) {
+                mTrans.push_back(-1);
+                continue;
+            }
+
+            auto it = ids.find(next);
+            if (it == ids.end()) {
+                it = ids.emplace(next, states.size()).first;
+                states.push_back(next);
+            }
+
+            mTrans.push_back(it->second);
+        }
+    }
+
+    mStart = 0;
+    return true;
+}
+
+std::size_t CompiledRegex::simulate(const char* begin, const char* end, const char** stop) const {
+    std::vector<int> list = startList();
+    std::size_t last = npos;
+    std::size_t i = 0;
+
+    for (; ; i++) {
+        if (list.empty())
+            break;
+
+        if (mProg[list.back()].mOp == Op::Match) {
+            last = i;
+            if (list.size() == 1)
+                break;
+        }
+
+        if (begin + i >= end)
+            break;
+
+        list = step(list, static_cast<unsigned char>(begin[i]));
+    }
+
+    if (stop != nullptr)
+        *stop = begin + i;
+
+    return last;
+}
+
+std::size_t CompiledRegex::match(const char* begin, const char* end, const char** stop) const {
+    if (!mSupported) {
+        std::cmatch m;
+
+        if (stop != nullptr)
+            *stop = end;
+
+        if (!std::regex_search(begin, end, m, *mFallback, std::regex_constants::match_continuous))
+            return npos;
+
+        return m.length(0);
+    }
+
+    if (!mUseDfa)
+        return simulate(begin, end, stop);
+
+    int numClasses = mClassRep.size();
+    int state = mStart;
+    std::size_t last = mAccepting[state] ? 0 : npos;
+    const char* p = begin;
+
+    for (; p < end && !mFinal[state]; p++) {
+        state = mTrans[state * numClasses + mByteClass[static_cast<unsigned char>(*p)]];
+
+        if (state < 0)
+            break;
+
+        if (mAccepting[state])
+            last = p - begin + 1;
+    }
+
+    if (stop != nullptr)
+        *stop = p;
+
+    return last;
+}
+
+bool CompiledRegex::usesDfa() const {
+    return mUseDfa;
+}
+
+bool CompiledRegex::isNative() const {
+    return mSupported;
+}
+
+std::bitset<256> CompiledRegex::firstBytes() const {
+    std::bitset<256> first;
+
+    if (!mSupported) {
+        first.set();
+        return first;
+    }
+
+    std::vector<int> start = startList();
+    for (int c = 0; c < 256; c++) {
+        if (!step(start, c).empty())
+            first.set(c);
+    }
+
+    return first;
+}
+
+bool CompiledRegex::matchesEmpty() const {
+    if (!mSupported)
+        return true;
+
+    std::vector<int> start = startList();
+    return !start.empty() && mProg[start.back()].mOp == Op::Match;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace Iguana {
+    class CompiledRegex {
+    private:
+        enum class Op : char {
+            Char,
+            Split,
+            Jmp,
+            Match,
+            Bol,
+        };
+
+        struct Inst {
+            Op mOp;
+            int mX;
+            int mY;
+        };
+
+        struct Re;
+        class Syntax;
+
+        std::vector<Inst> mProg;
+        std::vector<std::bitset<256>> mSets;
+
+        unsigned char mByteClass[256];
+        std::vector<unsigned char> mClassRep;
+
+        int mStart;
+        std::vector<int> mTrans;
+        std::vector<bool> mAccepting;
+        std::vector<bool> mFinal;
+
+        bool mSupported;
+        bool mUseDfa;
+        std::unique_ptr<std::regex> mFallback;
+
+        void emit(const Re&);
+        void computeByteClasses();
+        void closure(std::vector<int>&, std::vector<bool>&, int, bool) const;
+        void cutAfterMatch(std::vector<int>&) const;
+        std::vector<int> startList() const;
+        std::vector<int> step(const std::vector<int>&, unsigned char) const;
+        bool buildDfa();
+        std::size_t simulate(const char*, const char*, const char**) const;
+
+    public:
+        static const std::size_t npos = static_cast<std::size_t>(-1);
+
+        CompiledRegex(const std::string&);
+
+        // When stop is given it receives the last position examined, or end
+        // if the match ran into the end of input.
+        std::size_t match(const char*, const char*, const char** = nullptr) const;
+        bool usesDfa() const;
+        bool isNative() const;
+        std::bitset<256> firstBytes() const;
+        bool matchesEmpty() const;
+    };
+}
@@ -1,12 +1,38 @@
 #include <string>
 #include <vector>
 #include <cstdio>
+#include <cctype>
 #include <map>
 #include "constructor.h"
 #include "iguana.h"
+#include "charclass.h"
 
 using IC = IguanaConstructor;
 
+static bool isRegexAtom(const std::string& val) {
+    return val.length() > 2 && val.substr(0, 2) == "#|" && val.back() == '|';
+}
+
+// A regex that is one bracket expression followed by + runs as a CharClass
+// scan. CharClass reads a top-level | as a union, which a regex does not
+// mean, so the bracket has to close right before the +.
+static bool isClassRegex(const std::string& regex) {
+    if (regex.length() < 3 || regex.back() != '+' || regex[0] != '[')
+        return false;
+
+    std::size_t pos = 1;
+    if (regex[pos] == '^')
+        ++pos;
+
+    while (pos < regex.length() && regex[pos] != ']')
+        pos += regex[pos] == '\\' ? 2 : 1;
+
+    if (pos != regex.length() - 2)
+        return false;
+
+    return Iguana::CharClass(regex.substr(0, regex.length() - 1)).valid();
+}
+
 IC::Token::Token(const std::string& value, const std::string& type, int lin, int col)
     : type(type), value(value),
       lin(lin), col(col)
@@ -387,9 +413,17 @@ IC::ConstructResult IC::construct(std::string input) {
             std::string val = n.mVal;
             
             Iguana::Parser* interm;
-            if (val.length() > 2 && val.substr(0, 2) == "#|" && val.back() == '|') {
-                interm = Iguana::Parser::Regex(n.mName, val);
-                p->assign(interm); 
+            if (isRegexAtom(val)) {
+                std::string regex = val.substr(2, val.length() - 3);
+                std::string spec = regex.substr(0, regex.length() - 1);
+
+                if (isClassRegex(regex)) {
+                    interm = Iguana::Parser::Class(n.mName, spec);
+                } else {
+                    interm = Iguana::Parser::Regex(n.mName, regex);
+                }
+
+                p->assign(interm);
             } else {
                 interm = Iguana::Parser::String(val, n.mName);
                 p->assign(interm);
@@ -413,6 +447,7 @@ IC::ConstructResult IC::construct(std::string input) {
                 }
 
                 children.push_back(parsers[pName]);
+                ++idx;
                 continue;
             }
 
@@ -442,9 +477,186 @@ IC::ConstructResult IC::construct(std::string input) {
         delete interm;
     }
 
+    gpt->analyze();
+
     ConstructResult cres;
     cres.mGpt = gpt;
     cres.mIsError = false;
 
     return cres;
 }
+
+// Renders a string as a C++ literal. Non-printable bytes use three-digit
+// octal escapes so a following digit can never extend them.
+static std::string cppLiteral(const std::string& val) {
+    std::string res = "\"";
+
+    for (unsigned char ch : val) {
+        if (ch == '"' || ch == '\\') {
+            res += '\\';
+            res += ch;
+        } else if (ch < 0x20 || ch >= 0x7f) {
+            char buf[5];
+            std::snprintf(buf, sizeof(buf), "\\%03o", ch);
+            res += buf;
+        } else {
+            res += ch;
+        }
+    }
+
+    return res + "\"";
+}
+
+static bool isIdentifier(const std::string& val) {
+    if (val.empty() || std::isdigit(static_cast<unsigned char>(val[0])))
+        return false;
+
+    for (char ch : val) {
+        if (!std::isalnum(static_cast<unsigned char>(ch)) && ch != '_')
+            return false;
+    }
+
+    return true;
+}
+
+IC::GenerateResult IC::generate(std::string input, const std::string& name) {
+    GenerateResult gres;
+    gres.mIsError = true;
+
+    if (!isIdentifier(name)) {
+        gres.mErrorMsg = "Invalid generated namespace '" + name + "'";
+        return gres;
+    }
+
+    Lexer lex(input);
+    std::vector<Token*> lexemes = lex.lexInput();
+
+    Parser grammarParser;
+    grammarParser.mLexemes = lexemes;
+
+    ParseResult pres = grammarParser.parse();
+
+    if (pres.mIsError) {
+        gres.mErrorMsg = pres.mErrorMsg;
+        return gres;
+    }
+
+    std::vector<ParseNode>& nodes = pres.mNodes;
+    std::map<std::string, ParseNode*> rules;
+
+    for (ParseNode& n : nodes) {
+        if (rules.count(n.mName)) {
+            gres.mErrorMsg = "Duplicate parsers '" + n.mName + "'";
+            return gres;
+        }
+
+        rules[n.mName] = &n;
+    }
+
+    if (rules.count("ROOT") == 0) {
+        gres.mErrorMsg = "No ROOT production given";
+        return gres;
+    }
+
+    std::string names;
+    std::string decls;
+    std::string defs;
+
+    for (ParseNode& n : nodes) {
+        names += "    constexpr char n_" + n.mName + "[] = " + cppLiteral(n.mName) + ";\n";
+        decls += "    struct r_" + n.mName + ";\n";
+
+        if (n.mType == "ATOM") {
+            std::string val = n.mVal;
+
+            if (isRegexAtom(val)) {
+                std::string regex = val.substr(2, val.length() - 3);
+
+                if (isClassRegex(regex)) {
+                    names += "    constexpr char c_" + n.mName + "[] = "
+                        + cppLiteral(regex.substr(0, regex.length() - 1)) + ";\n";
+                    defs += "    struct r_" + n.mName + " : Static::Class<n_" + n.mName
+                        + ", c_" + n.mName + "> {};\n";
+                } else {
+                    names += "    constexpr char x_" + n.mName + "[] = " + cppLiteral(regex) + ";\n";
+                    defs += "    struct r_" + n.mName + " : Static::Regex<n_" + n.mName
+                        + ", x_" + n.mName + "> {};\n";
+                }
+            } else {
+                names += "    constexpr char l_" + n.mName + "[] = " + cppLiteral(val) + ";\n";
+                defs += "    struct r_" + n.mName + " : Static::String<n_" + n.mName
+                    + ", l_" + n.mName + "> {};\n";
+            }
+
+            continue;
+        }
+
+        if (n.mValues.empty()) {
+            gres.mErrorMsg = "Parser " + n.mName + " has no alternatives";
+            return gres;
+        }
+
+        std::string alts;
+        for (std::size_t idx = 0; idx < n.mValues.size(); idx++) {
+            std::vector<std::string>& branch = n.mValues[idx];
+
+            for (std::string& child : branch) {
+                if (rules.count(child) == 0) {
+                    gres.mErrorMsg = "Parser " + child + " not found";
+                    return gres;
+                }
+            }
+
+            alts += ",\n        ";
+
+            if (branch.size() == 1) {
+                alts += "r_" + branch[0];
+                continue;
+            }
+
+            alts += "Static::And<n_";
+            for (std::size_t c = 0; c < branch.size(); c++) {
+                if (n.mInclude[idx][c])
+                    alts += ", r_" + branch[c];
+                else
+                    alts += ", Static::Hide<r_" + branch[c] + ">";
+            }
+            alts += ">";
+        }
+
+        defs += "    struct r_" + n.mName + " : Static::Or<n_" + n.mName + alts + "> {};\n";
+    }
+
+    gres.mHeader = "// Generated by iguanagen. Do not edit.\n"
+        "#pragma once\n"
+        "\n"
+        "#include \"iguana.h\"\n"
+        "#include \"codetracker.h\"\n"
+        "\n"
+        "namespace " + name + " {\n"
+        "    // Parses the input from the tracker's position with the ROOT production.\n"
+        "    Iguana::ParseResult* parse(CodeTracker*);\n"
+        "}\n";
+
+    gres.mSource = "// Generated by iguanagen. Do not edit.\n"
+        "#include \"" + name + ".h\"\n"
+        "#include \"staticgrammar.h\"\n"
+        "\n"
+        "using namespace Iguana;\n"
+        "\n"
+        "namespace {\n"
+        "    constexpr char n_[] = \"\";\n"
+        + names
+        + "\n"
+        + decls
+        + "\n"
+        + defs
+        + "}\n"
+        "\n"
+        "ParseResult* " + name + "::parse(CodeTracker* trckr) {\n"
+        "    return Static::parse<r_ROOT>(trckr);\n"
+        "}\n";
+
+    gres.mIsError = false;
+    return gres;
+}
@@ -89,9 +89,17 @@ private:
         bool mIsError;
     };
 
+    struct GenerateResult {
+        std::string mHeader;
+        std::string mSource;
+        std::string mErrorMsg;
+        bool mIsError;
+    };
+
 public:
     void testLexer(std::string);
     void testParser(std::string);
 
     static ConstructResult construct(std::string);
+    static GenerateResult generate(std::string, const std::string&);
 };
@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include "codetracker.h"
+#include "iguana.h"
+#include "arena.h"
+#include "context.h"
+
+using namespace Iguana;
+
+static const std::size_t DEFAULT_ARENA_SIZE = 64 * 1024;
+
+bool MemoKey::operator==(const MemoKey& other) const {
+    return mParser == other.mParser && mIdx == other.mIdx;
+}
+
+std::size_t MemoKeyHash::operator()(const MemoKey& key) const {
+    std::size_t h = std::hash<const Parser*>()(key.mParser);
+    return h ^ (std::hash<std::size_t>()(key.mIdx) + 0x9e3779b9 + (h << 6) + (h >> 2));
+}
+
+MemoTable::MemoTable(Arena* arena)
+    : mArena(arena), mEntries(nullptr), mNodeArena(nullptr), mNodeBytes(0)
+{}
+
+MemoTable::~MemoTable() {
+    for (Generation& gen : mHistory)
+        delete gen.mArena;
+
+    delete mNodeArena;
+}
+
+MemoEntry* MemoTable::find(const Parser* p, std::size_t idx) {
+    if (mEntries != nullptr) {
+        auto it = mEntries->find(MemoKey{ p, idx });
+
+        if (it != mEntries->end())
+            return &it->second;
+    }
+
+    if (mHistory.empty())
+        return nullptr;
+
+    return recall(p, idx);
+}
+
+// Looks for an entry of an earlier parse that the edits since then left
+// alone, and moves it into the current table at its new offset. The tree
+// stays where it is; its nodes are settled when they are read.
+MemoEntry* MemoTable::recall(const Parser* p, std::size_t idx) {
+    std::size_t pos = idx;
+
+    for (std::size_t g = mHistory.size(); g-- > 0;) {
+        const Generation& gen = mHistory[g];
+        if (gen.mRevision == nullptr)
+            return nullptr;
+
+        // Map idx back into the text this generation parsed. Offsets inside
+        // inserted text have no counterpart there or in anything older.
+        const std::vector<Edit>& edits = gen.mRevision->mEdits;
+        for (auto e = edits.rbegin(); e != edits.rend(); ++e) {
+            if (pos >= e->mNewEnd)
+                pos = pos - e->mNewEnd + e->mOldEnd;
+            else if (pos >= e->mStart)
+                return nullptr;
+        }
+
+        if (gen.mEntries == nullptr)
+            continue;
+
+        auto it = gen.mEntries->find(MemoKey{ p, pos });
+        if (it == gen.mEntries->end())
+            continue;
+
+        // The entry holds if no edit since touched the bytes it looked at.
+        const MemoEntry& old = it->second;
+        std::size_t start = pos;
+        std::size_t reach = old.mReach;
+        bool unchanged = true;
+
+        for (std::size_t h = g; h < mHistory.size() && unchanged; h++) {
+            for (const Edit& e : mHistory[h].mRevision->mEdits) {
+                if (reach < e.mStart)
+                    continue;
+
+                if (start < e.mOldEnd) {
+                    unchanged = false;
+                    break;
+                }
+
+                start = start - e.mOldEnd + e.mNewEnd;
+                reach = reach - e.mOldEnd + e.mNewEnd;
+            }
+        }
+
+        if (!unchanged)
+            continue;
+
+        if (mEntries == nullptr)
+            mEntries = mArena->make<Map>();
+
+        RuleResult* cached = mArena->make<RuleResult>();
+        cached->mError = old.mResult->mError;
+        cached->mMsg = old.mResult->mMsg;
+        cached->mNode = old.mResult->mNode;
+
+        MemoEntry& entry = (*mEntries)[MemoKey{ p, idx }];
+        entry.mEnd.mIdx = old.mEnd.mIdx - pos + idx;
+        entry.mResult = cached;
+        entry.mReach = reach;
+        entry.mFailPos = old.mExpectedCount == 0 ? 0 : old.mFailPos - pos + idx;
+        entry.mExpected = copyExpected(old.mExpected, old.mExpectedCount);
+        entry.mExpectedCount = old.mExpectedCount;
+
+        return &entry;
+    }
+
+    return nullptr;
+}
+
+void MemoTable::store(const Parser* p, std::size_t idx, RuleResult* res, CodeTracker* trckr) {
+    if (mEntries == nullptr)
+        mEntries = mArena->make<Map>();
+
+    // Nodes are shared rather than rebuilt, so the entry keeps the
+    // result's own tree.
+    RuleResult* cached = mArena->make<RuleResult>();
+    cached->mError = res->mError;
+    cached->mMsg = res->mMsg;
+    cached->mNode = res->mNode;
+
+    ParseContext* ctx = trckr->mCtx;
+
+    MemoEntry& entry = (*mEntries)[MemoKey{ p, idx }];
+    entry.mEnd = trckr->save();
+    entry.mResult = cached;
+    entry.mReach = trckr->mReach;
+    entry.mFailPos = ctx->mFailPos;
+    entry.mExpected = copyExpected(ctx->mExpected.data(), ctx->mExpected.size());
+    entry.mExpectedCount = ctx->mExpected.size();
+}
+
+const Parser** MemoTable::copyExpected(const Parser* const* expected, std::size_t count) {
+    if (count == 0)
+        return nullptr;
+
+    const Parser** copy = static_cast<const Parser**>(mArena->allocate(count * sizeof(const Parser*), alignof(const Parser*)));
+    std::copy(expected, expected + count, copy);
+    return copy;
+}
+
+void MemoTable::bind(Arena* arena) {
+    mArena = arena;
+    mEntries = nullptr;
+    mPending.clear();
+
+    for (Generation& gen : mHistory)
+        delete gen.mArena;
+
+    mHistory.clear();
+
+    delete mNodeArena;
+    mNodeArena = nullptr;
+    mNodeBytes = 0;
+    mRevisions.clear();
+}
+
+// Records an edit of the text the current table was built from. It takes
+// effect with the next advance().
+void MemoTable::edit(const Edit& edit) {
+    mPending.push_back(edit);
+}
+
+// Starts a table for a parse of input in arena. The current one, and the
+// arena holding it, become the newest earlier generation; past
+// MAX_GENERATIONS the oldest is dropped.
+void MemoTable::advance(Arena* arena, std::string_view input, LineIndex* lines) {
+    if (mNodeArena == nullptr) {
+        mNodeArena = new Arena();
+    } else if (mNodeBytes == 0) {
+        // Until the first compact(), the tree of the first parse stands in
+        // for what is live.
+        mNodeBytes = mNodeArena->bytesUsed();
+    } else if (mNodeArena->bytesUsed() > MAX_NODE_GROWTH * mNodeBytes || mRevisions.size() > MAX_REVISIONS) {
+        compact();
+    }
+
+    const Revision* prev = nullptr;
+    if (!mRevisions.empty()) {
+        mRevisions.back().mEdits = std::move(mPending);
+        prev = &mRevisions.back();
+    }
+    mPending.clear();
+
+    mHistory.push_back(Generation{ mArena, mEntries, prev });
+
+    if (mHistory.size() > MAX_GENERATIONS) {
+        delete mHistory.front().mArena;
+        mHistory.erase(mHistory.begin());
+    }
+
+    mRevisions.push_back(Revision{ input, lines, {}, nullptr });
+    if (prev != nullptr)
+        mRevisions[mRevisions.size() - 2].mNext = &mRevisions.back();
+
+    mArena = arena;
+    mEntries = nullptr;
+}
+
+// Marks a node of the arena compact() is dropping as already copied.
+static const Revision MOVED{};
+
+// Every parse leaves the nodes it replaced behind in the node arena, and
+// every stale node needs the revisions since it was built. Once either
+// piles up, the nodes the current table holds are copied, settled, into
+// a fresh arena, and the older tables and revisions are dropped.
+void MemoTable::compact() {
+    Arena* arena = new Arena();
+    std::pmr::polymorphic_allocator<Node> alloc(arena);
+    std::vector<Node*> stack;
+
+    // Copies count nodes from old, or finds the copy made earlier, so
+    // arrays shared between subtrees stay shared. The old nodes are
+    // dropped right after, so the first one is overwritten to point at the
+    // copy.
+    auto evacuate = [&](const Node* old, std::size_t count) {
+        if (old->mRevision == &MOVED)
+            return const_cast<Node*>(&old->mNodes.front());
+
+        Node* data = alloc.allocate(count);
+
+        for (std::size_t i = 0; i < count; i++) {
+            old[i].settle();
+            alloc.construct(data + i, old[i]);
+            stack.push_back(data + i);
+        }
+
+        Node* first = const_cast<Node*>(old);
+        first->mNodes = NodeList(data, count);
+        first->mRevision = &MOVED;
+        return data;
+    };
+
+    if (mEntries != nullptr) {
+        for (auto& kv : *mEntries) {
+            RuleResult* res = kv.second.mResult;
+            if (!res->mError)
+                res->mNode = evacuate(res->mNode, 1);
+        }
+    }
+
+    while (!stack.empty()) {
+        Node* n = stack.back();
+        stack.pop_back();
+
+        if (!n->mNodes.empty())
+            n->mNodes = NodeList(evacuate(&n->mNodes.front(), n->mNodes.size()), n->mNodes.size());
+    }
+
+    delete mNodeArena;
+    mNodeArena = arena;
+    mNodeBytes = arena->bytesUsed();
+
+    for (Generation& gen : mHistory)
+        delete gen.mArena;
+
+    mHistory.clear();
+
+    while (mRevisions.size() > 1)
+        mRevisions.pop_front();
+}
+
+std::size_t MemoTable::size() {
+    if (mEntries == nullptr)
+        return 0;
+
+    return mEntries->size();
+}
+
+Arena* MemoTable::nodeArena() {
+    return mNodeArena;
+}
+
+const Revision* MemoTable::revision() {
+    if (mRevisions.empty())
+        return nullptr;
+
+    return &mRevisions.back();
+}
+
+ParseContext::ParseContext()
+    : mArena(new Arena()), mMemo(mArena),
+    mMemoHits(0), mMemoMisses(0), mFailPos(0), mRetain(false), mSerial(false),
+    mPool(nullptr)
+{}
+
+ParseContext::~ParseContext() {
+    delete mArena;
+}
+
+Arena* ParseContext::arena() {
+    return mArena;
+}
+
+// Where parsers build nodes: the arena of the parse, unless an incremental
+// session keeps them across parses.
+Arena* ParseContext::nodeArena() {
+    Arena* nodes = mMemo.nodeArena();
+    return nodes != nullptr ? nodes : mArena;
+}
+
+Arena* ParseContext::release() {
+    Arena* arena = mArena;
+
+    // Start the next arena about as big as this parse needed, so a run of
+    // small documents does not hold a full default chunk per result.
+    std::size_t size = 1024;
+    while (size < arena->bytesUsed() && size < DEFAULT_ARENA_SIZE)
+        size *= 2;
+
+    mArena = new Arena(size);
+    mMemo.bind(mArena);
+
+    return arena;
+}
+
+void ParseContext::reset() {
+    mArena->reset();
+    mMemo.bind(mArena);
+    mMemoHits = 0;
+    mMemoMisses = 0;
+    mSeeds.clear();
+    clearFailures();
+}
+
+void ParseContext::edit(const Edit& edit) {
+    mMemo.edit(edit);
+}
+
+// Moves on to a fresh arena and memo table for a parse of trckr's input.
+// The old ones are kept for the memo table to reuse entries from.
+void ParseContext::rebase(CodeTracker* trckr) {
+    mArena = new Arena();
+    mMemo.advance(mArena, trckr->input(), trckr->mLines.get());
+    mMemoHits = 0;
+    mMemoMisses = 0;
+    clearFailures();
+}
+
+FailureMark ParseContext::failureMark() const {
+    return FailureMark{ mFailPos, mExpected.size() };
+}
+
+// Whether anything failed at pos after the mark was taken.
+bool ParseContext::failedSince(FailureMark mark, std::size_t pos) const {
+    if (mFailPos != pos)
+        return false;
+
+    return mExpected.size() > (mark.mPos == pos ? mark.mCount : 0);
+}
+
+void ParseContext::expect(const Parser* p, std::size_t pos) {
+    if (pos < mFailPos)
+        return;
+
+    if (pos > mFailPos) {
+        mFailPos = pos;
+        mExpected.clear();
+    }
+
+    for (const Parser* e : mExpected) {
+        if (e == p)
+            return;
+    }
+
+    mExpected.push_back(p);
+}
+
+// Records p in place of whatever failed at pos since the mark, so a parser
+// can stand in for the alternatives it tried.
+void ParseContext::expect(const Parser* p, std::size_t pos, FailureMark mark) {
+    if (pos == mFailPos)
+        mExpected.resize(mark.mPos == pos ? mark.mCount : 0);
+
+    expect(p, pos);
+}
+
+void ParseContext::clearFailures() {
+    mFailPos = 0;
+    mExpected.clear();
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "iguana.h"
+#include "arena.h"
+
+namespace Iguana {
+    class WorkerPool;
+
+    struct MemoKey {
+        const Parser* mParser;
+        std::size_t mIdx;
+
+        bool operator==(const MemoKey&) const;
+    };
+
+    struct MemoKeyHash {
+        std::size_t operator()(const MemoKey&) const;
+    };
+
+    struct MemoEntry {
+        CodeTracker::Checkpoint mEnd;
+        RuleResult* mResult;
+
+        // Farthest offset the parse looked at, so an edit past it leaves
+        // the entry valid.
+        std::size_t mReach;
+
+        // Farthest failure inside the parse, replayed on a hit so error
+        // messages come out as if the parse had run again.
+        std::size_t mFailPos;
+        const Parser** mExpected;
+        std::size_t mExpectedCount;
+    };
+
+    // Replacement of the bytes [mStart, mOldEnd) of a text by new bytes
+    // ending at mNewEnd. Offsets of later edits in a batch are in the text
+    // as changed by the earlier ones.
+    struct Edit {
+        std::size_t mStart;
+        std::size_t mOldEnd;
+        std::size_t mNewEnd;
+    };
+
+    // Text of one parse of an incremental session, and the edits made to
+    // it before the next. Nodes point at the revision they were built in
+    // and are settled through the later ones when next read.
+    struct Revision {
+        std::string_view mInput;
+        LineIndex* mLines;
+        std::vector<Edit> mEdits;
+        const Revision* mNext;
+    };
+
+    class MemoTable {
+    private:
+        using Map = std::pmr::unordered_map<MemoKey, MemoEntry, MemoKeyHash, std::equal_to<MemoKey>>;
+
+        // Table of an earlier parse, read through the edits made since.
+        // mRevision is nullptr for the table from before the session.
+        struct Generation {
+            Arena* mArena;
+            Map* mEntries;
+            const Revision* mRevision;
+        };
+
+        static const std::size_t MAX_GENERATIONS = 8;
+        static const std::size_t MAX_REVISIONS = 64;
+
+        // How many times what was live at the last compact() the node
+        // arena may grow to before the next.
+        static const std::size_t MAX_NODE_GROWTH = 4;
+
+        Arena* mArena;
+        Map* mEntries;
+        std::vector<Edit> mPending;
+        std::vector<Generation> mHistory;
+
+        // Nodes of an incremental session, shared by the tables of all its
+        // parses, and how many bytes of them compact() last kept.
+        Arena* mNodeArena;
+        std::size_t mNodeBytes;
+        std::deque<Revision> mRevisions;
+
+        const Parser** copyExpected(const Parser* const*, std::size_t);
+        MemoEntry* recall(const Parser*, std::size_t);
+        void compact();
+
+    public:
+        MemoTable(Arena*);
+        MemoTable(const MemoTable&) = delete;
+        MemoTable& operator=(const MemoTable&) = delete;
+        ~MemoTable();
+
+        MemoEntry* find(const Parser*, std::size_t);
+        void store(const Parser*, std::size_t, RuleResult*, CodeTracker*);
+        void bind(Arena*);
+        void edit(const Edit&);
+        void advance(Arena*, std::string_view, LineIndex*);
+        std::size_t size();
+
+        // nullptr outside an incremental session.
+        Arena* nodeArena();
+        const Revision* revision();
+    };
+
+    // A left-recursive rule being grown at mPos. Its calls at mPos get
+    // mNode, the longest parse so far, instead of recursing; nullptr until
+    // the first parse that does not depend on it has succeeded.
+    struct Seed {
+        const Parser* mParser;
+        std::size_t mPos;
+        Node* mNode;
+        CodeTracker::Checkpoint mEnd;
+    };
+
+    struct FailureMark {
+        std::size_t mPos;
+        std::size_t mCount;
+    };
+
+    class ParseContext {
+    private:
+        Arena* mArena;
+
+    public:
+        MemoTable mMemo;
+        unsigned long mMemoHits;
+        unsigned long mMemoMisses;
+
+        // Farthest offset any parser failed at, and the parsers that failed
+        // there. The error message is built from these once the parse fails.
+        std::size_t mFailPos;
+        std::vector<const Parser*> mExpected;
+
+        std::vector<Seed> mSeeds;
+
+        // Keep the arena, and with it the memo table, when a parse finishes
+        // instead of handing it to the result, so a later parse of an edited
+        // input can reuse the entries.
+        bool mRetain;
+
+        // Set on the contexts of parallel workers, so repetitions marked
+        // for parallel parsing run serially inside them.
+        bool mSerial;
+
+        // Threads repetitions marked for parallel parsing run on; nullptr
+        // uses WorkerPool::shared().
+        WorkerPool* mPool;
+
+        ParseContext();
+        ParseContext(const ParseContext&) = delete;
+        ParseContext& operator=(const ParseContext&) = delete;
+        ~ParseContext();
+
+        Arena* arena();
+        Arena* nodeArena();
+        Arena* release();
+        void reset();
+        void edit(const Edit&);
+        void rebase(CodeTracker*);
+
+        FailureMark failureMark() const;
+        bool failedSince(FailureMark, std::size_t) const;
+        void expect(const Parser*, std::size_t);
+        void expect(const Parser*, std::size_t, FailureMark);
+        void clearFailures();
+
+        template <typename T, typename... Args>
+        T* make(Args&&... args) {
+            return mArena->make<T>(std::forward<Args>(args)...);
+        }
+    };
+}
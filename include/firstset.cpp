@@ -0,0 +1,195 @@
+#include <bitset>
+#include <map>
+#include <memory>
+#include <vector>
+#include "firstset.h"
+#include "iguana.h"
+#include "compiledregex.h"
+
+using namespace Iguana;
+
+FirstSet::FirstSet()
+    : mEmptyAtEof(false)
+{}
+
+FirstSet FirstSet::any() {
+    FirstSet set;
+    set.mBytes.invert();
+    set.mEmpty.invert();
+    set.mEmptyAtEof = true;
+    return set;
+}
+
+bool FirstSet::admits(int sym) const {
+    if (sym == 256)
+        return mEmptyAtEof;
+
+    return mBytes.test(sym) || mEmpty.test(sym);
+}
+
+void FirstSet::merge(const FirstSet& other) {
+    mBytes.merge(other.mBytes);
+    mEmpty.merge(other.mEmpty);
+    mEmptyAtEof = mEmptyAtEof || other.mEmptyAtEof;
+}
+
+bool FirstSet::operator==(const FirstSet& other) const {
+    return mBytes == other.mBytes
+        && mEmpty == other.mEmpty
+        && mEmptyAtEof == other.mEmptyAtEof;
+}
+
+FirstSets::FirstSets(const std::vector<Parser*>& roots) {
+    for (Parser* p : roots)
+        collect(p);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (std::pair<Parser* const, FirstSet>& entry : mSets) {
+            FirstSet set = compute(entry.first);
+
+            if (!(set == entry.second)) {
+                entry.second = set;
+                changed = true;
+            }
+        }
+    }
+}
+
+void FirstSets::collect(Parser* p) {
+    if (mSets.count(p))
+        return;
+
+    mSets[p] = FirstSet();
+
+    for (Parser* child : p->mParsers)
+        collect(child);
+}
+
+FirstSet FirstSets::compute(Parser* p) {
+    FirstSet set;
+
+    switch (p->mType) {
+        case PTypes::String:
+            if (p->mToParse.empty())
+                return FirstSet::any();
+
+            set.mBytes.set(static_cast<unsigned char>(p->mToParse[0]));
+            return set;
+
+        case PTypes::Alphabetic:
+        case PTypes::Alphanumeric:
+        case PTypes::Digit:
+        case PTypes::Custom:
+        case PTypes::Class:
+            set.mBytes = p->mClass.set();
+            return set;
+
+        case PTypes::Regex: {
+            std::bitset<256> first = p->mRegex->firstBytes();
+            for (int b = 0; b < 256; ++b) {
+                if (first.test(b))
+                    set.mBytes.set(b);
+            }
+            return set;
+        }
+
+        case PTypes::EndOfFile:
+            set.mEmptyAtEof = true;
+            return set;
+
+        case PTypes::And:
+            set.mEmpty.invert();
+            set.mEmptyAtEof = true;
+
+            for (Parser* child : p->mParsers) {
+                const FirstSet& cs = mSets[child];
+
+                ByteSet bytes = cs.mBytes;
+                bytes.intersect(set.mEmpty);
+                set.mBytes.merge(bytes);
+                set.mEmpty.intersect(cs.mEmpty);
+                set.mEmptyAtEof = set.mEmptyAtEof && cs.mEmptyAtEof;
+            }
+            return set;
+
+        case PTypes::Or:
+            for (Parser* child : p->mParsers)
+                set.merge(mSets[child]);
+            return set;
+
+        case PTypes::Many:
+        case PTypes::MoreThan:
+        case PTypes::LessThan:
+            return mSets[p->mParsers[0]];
+
+        case PTypes::Number:
+        case PTypes::Range:
+            set = mSets[p->mParsers[0]];
+            if (p->mLowerAmt == 0) {
+                set.mEmpty = FirstSet::any().mEmpty;
+                set.mEmptyAtEof = true;
+            }
+            return set;
+
+        case PTypes::Closure:
+            set.mBytes = mSets[p->mParsers[0]].mBytes;
+            set.mEmpty.invert();
+            set.mEmptyAtEof = true;
+            return set;
+
+        case PTypes::Until: {
+            const FirstSet& until = mSets[p->mParsers[1]];
+
+            set.mBytes = mSets[p->mParsers[0]].mBytes;
+            set.mEmpty = until.mBytes;
+            set.mEmpty.merge(until.mEmpty);
+            set.mEmptyAtEof = until.mEmptyAtEof;
+            return set;
+        }
+
+        default:
+            return FirstSet::any();
+    }
+}
+
+const FirstSet& FirstSets::of(Parser* p) const {
+    return mSets.at(p);
+}
+
+std::shared_ptr<const OrDispatch> FirstSets::dispatch(Parser* p) const {
+    std::shared_ptr<OrDispatch> table = std::make_shared<OrDispatch>();
+    std::map<std::vector<Parser*>, std::uint16_t> listIds;
+    bool pruned = false;
+
+    for (int sym = 0; sym <= 256; ++sym) {
+        std::vector<Parser*> candidates;
+        std::vector<bool> skipped;
+
+        for (std::size_t i = 0; i < p->mParsers.size(); ++i) {
+            if (of(p->mParsers[i]).admits(sym)) {
+                skipped.push_back(i > candidates.size());
+                candidates.push_back(p->mParsers[i]);
+            }
+        }
+
+        skipped.push_back(candidates.size() < p->mParsers.size());
+        pruned = pruned || skipped.back();
+
+        auto it = listIds.find(candidates);
+        if (it == listIds.end()) {
+            it = listIds.emplace(candidates, table->mLists.size()).first;
+            table->mLists.push_back(candidates);
+            table->mPruned.push_back(skipped);
+        }
+
+        table->mTable[sym] = it->second;
+    }
+
+    if (!pruned)
+        return nullptr;
+
+    return table;
+}
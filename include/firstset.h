@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "scan.h"
+
+namespace Iguana {
+    class Parser;
+
+    // What a parser may see next, once leading whitespace is skipped, and
+    // still succeed. mBytes holds first bytes of non-empty matches; mEmpty
+    // and mEmptyAtEof hold the lookahead under which it can succeed without
+    // consuming anything.
+    struct FirstSet {
+        ByteSet mBytes;
+        ByteSet mEmpty;
+        bool mEmptyAtEof;
+
+        FirstSet();
+
+        static FirstSet any();
+
+        // Symbol is a byte value, or 256 for end of input.
+        bool admits(int) const;
+        void merge(const FirstSet&);
+        bool operator==(const FirstSet&) const;
+    };
+
+    // Alternatives of an Or worth trying for each next symbol, in their
+    // original order. End of input is entry 256; symbols with the same
+    // candidates share a list. mPruned[list][i] tells whether any
+    // alternative ahead of candidate i was left out, with i == size()
+    // standing for the case where every candidate fails.
+    struct OrDispatch {
+        std::uint16_t mTable[257];
+        std::vector<std::vector<Parser*>> mLists;
+        std::vector<std::vector<bool>> mPruned;
+    };
+
+    // FIRST sets of every parser reachable from the given roots. Recursive
+    // rules are resolved by iterating to the least fixed point.
+    class FirstSets {
+    private:
+        std::map<Parser*, FirstSet> mSets;
+
+        void collect(Parser*);
+        FirstSet compute(Parser*);
+
+    public:
+        FirstSets(const std::vector<Parser*>&);
+
+        const FirstSet& of(Parser*) const;
+        std::shared_ptr<const OrDispatch> dispatch(Parser*) const;
+    };
+}
@@ -0,0 +1,195 @@
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "iguana.h"
+#include "flat.h"
+
+using namespace Iguana;
+
+FlatTree::Cursor::Cursor(const FlatTree* tree, std::int32_t idx)
+    : mTree(tree), mIdx(idx)
+{}
+
+bool FlatTree::Cursor::valid() const {
+    return mIdx >= 0;
+}
+
+std::uint32_t FlatTree::Cursor::rule() const {
+    return mTree->mNodes[mIdx].mRule;
+}
+
+const std::string& FlatTree::Cursor::name() const {
+    return mTree->mRules[rule()];
+}
+
+std::size_t FlatTree::Cursor::start() const {
+    return mTree->mNodes[mIdx].mStart;
+}
+
+std::size_t FlatTree::Cursor::end() const {
+    return mTree->mNodes[mIdx].mEnd;
+}
+
+std::string_view FlatTree::Cursor::text() const {
+    const FlatNode& n = mTree->mNodes[mIdx];
+    return mTree->mInput.substr(n.mStart, n.mEnd - n.mStart);
+}
+
+bool FlatTree::Cursor::hasChildren() const {
+    return mTree->mNodes[mIdx].mFirstChild >= 0;
+}
+
+FlatTree::Cursor FlatTree::Cursor::firstChild() const {
+    return Cursor(mTree, mTree->mNodes[mIdx].mFirstChild);
+}
+
+FlatTree::Cursor FlatTree::Cursor::nextSibling() const {
+    return Cursor(mTree, mTree->mNodes[mIdx].mNextSibling);
+}
+
+std::int32_t FlatTree::Cursor::index() const {
+    return mIdx;
+}
+
+FlatTree::FlatTree(std::string_view input)
+    : mInput(input)
+{}
+
+FlatTree FlatTree::fromNode(const Node& root, std::string_view input) {
+    struct Frame {
+        const Node* mNode;
+        std::int32_t mIdx;
+        std::size_t mNext;
+        std::int32_t mPrev;
+    };
+
+    FlatTree tree(input);
+    std::vector<Frame> stack;
+
+    std::int32_t rootIdx = tree.append(tree.ruleId(root.mName), root.mStart, root.mEnd);
+    stack.push_back(Frame{ &root, rootIdx, 0, -1 });
+
+    while (!stack.empty()) {
+        Frame& f = stack.back();
+
+        if (f.mNext == f.mNode->mNodes.size()) {
+            stack.pop_back();
+            continue;
+        }
+
+        const Node& child = f.mNode->mNodes[f.mNext++];
+        std::int32_t idx = tree.append(tree.ruleId(child.mName), child.mStart, child.mEnd);
+
+        if (f.mPrev < 0)
+            tree.mNodes[f.mIdx].mFirstChild = idx;
+        else
+            tree.mNodes[f.mPrev].mNextSibling = idx;
+
+        f.mPrev = idx;
+        stack.push_back(Frame{ &child, idx, 0, -1 });
+    }
+
+    tree.mNodes.shrink_to_fit();
+    return tree;
+}
+
+std::uint32_t FlatTree::ruleId(std::string_view name) {
+    auto it = mRuleIds.find(name);
+
+    if (it != mRuleIds.end())
+        return it->second;
+
+    std::uint32_t id = mRules.size();
+    mRules.emplace_back(name);
+    mRuleIds.emplace(std::string(name), id);
+
+    return id;
+}
+
+const std::string& FlatTree::ruleName(std::uint32_t id) const {
+    return mRules[id];
+}
+
+std::int32_t FlatTree::append(std::uint32_t rule, std::size_t start, std::size_t end) {
+    if (mNodes.size() > std::size_t(std::numeric_limits<std::int32_t>::max()))
+        throw "FlatTree has too many nodes";
+
+    mNodes.push_back(FlatNode{ start, end, rule, -1, -1 });
+    return mNodes.size() - 1;
+}
+
+FlatTree::Cursor FlatTree::root() const {
+    return Cursor(this, mNodes.empty() ? -1 : 0);
+}
+
+const FlatNode& FlatTree::at(std::int32_t idx) const {
+    return mNodes[idx];
+}
+
+std::size_t FlatTree::size() const {
+    return mNodes.size();
+}
+
+std::size_t FlatTree::memoryUsage() const {
+    std::size_t total = mNodes.capacity() * sizeof(FlatNode);
+
+    for (const std::string& r : mRules)
+        total += sizeof(std::string) + r.capacity();
+
+    return total;
+}
+
+FlatBuilder::FlatBuilder(FlatTree* tree)
+    : mTree(tree), mLastTop(-1)
+{}
+
+// Appends a node as the next child of the innermost open rule.
+std::int32_t FlatBuilder::add(const std::string& name, std::size_t start, std::size_t end) {
+    std::int32_t idx = mTree->append(mTree->ruleId(name), start, end);
+    std::int32_t& last = mOpen.empty() ? mLastTop : mOpen.back().mLast;
+
+    if (last >= 0)
+        mTree->mNodes[last].mNextSibling = idx;
+    else if (!mOpen.empty())
+        mTree->mNodes[mOpen.back().mIdx].mFirstChild = idx;
+
+    last = idx;
+    return idx;
+}
+
+void FlatBuilder::enterRule(const std::string& name, std::size_t start) {
+    std::int32_t idx = add(name, start, start);
+    mOpen.push_back(Open{ idx, -1 });
+}
+
+void FlatBuilder::leaf(const std::string& name, std::string_view text) {
+    std::size_t start = text.data() - mTree->mInput.data();
+    add(name, start, start + text.length());
+}
+
+void FlatBuilder::exitRule(const std::string&, std::size_t end) {
+    mTree->mNodes[mOpen.back().mIdx].mEnd = end;
+    mOpen.pop_back();
+}
+
+static void displayCursor(FlatTree::Cursor c, IndentTracker* trckr) {
+    for (; c.valid(); c = c.nextSibling()) {
+        std::cout << trckr->getIndentStr() << c.name()
+            << " [" << c.start() << "," << c.end() << ")";
+
+        if (!c.hasChildren())
+            std::cout << " " << c.text();
+
+        std::cout << std::endl;
+
+        trckr->increment();
+        displayCursor(c.firstChild(), trckr);
+        trckr->decrement();
+    }
+}
+
+void FlatTree::display() const {
+    IndentTracker trckr(3);
+    displayCursor(root(), &trckr);
+}
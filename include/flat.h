@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <map>
+#include <vector>
+#include "iguana.h"
+#include "vm.h"
+
+namespace Iguana {
+    struct FlatNode {
+        std::uint64_t mStart;
+        std::uint64_t mEnd;
+        std::uint32_t mRule;
+        std::int32_t mFirstChild;
+        std::int32_t mNextSibling;
+    };
+
+    class FlatTree {
+    private:
+        std::vector<FlatNode> mNodes;
+        std::vector<std::string> mRules;
+        std::map<std::string, std::uint32_t, std::less<>> mRuleIds;
+        std::string_view mInput;
+
+    public:
+        class Cursor {
+        private:
+            const FlatTree* mTree;
+            std::int32_t mIdx;
+
+        public:
+            Cursor(const FlatTree*, std::int32_t);
+
+            bool valid() const;
+            std::uint32_t rule() const;
+            const std::string& name() const;
+            std::size_t start() const;
+            std::size_t end() const;
+            std::string_view text() const;
+            bool hasChildren() const;
+            Cursor firstChild() const;
+            Cursor nextSibling() const;
+            std::int32_t index() const;
+        };
+
+        // The input must outlive the tree; it may be a MappedFile's view.
+        FlatTree(std::string_view);
+
+        static FlatTree fromNode(const Node&, std::string_view);
+
+        std::uint32_t ruleId(std::string_view);
+        const std::string& ruleName(std::uint32_t) const;
+        // Throws once the tree would outgrow 32-bit node indices.
+        std::int32_t append(std::uint32_t, std::size_t, std::size_t);
+
+        Cursor root() const;
+        const FlatNode& at(std::int32_t) const;
+        std::size_t size() const;
+        std::size_t memoryUsage() const;
+        void display() const;
+
+        friend class FlatBuilder;
+    };
+
+    // Lays out a FlatTree from the events of Program::parse(CodeTracker*,
+    // ParseHandler*), so the parse never builds a Node tree and memory is
+    // the flat tree plus what the VM keeps for backtracking. The tree must
+    // read the same input as the CodeTracker. On a failed parse it holds
+    // only the nodes sent before the failure.
+    class FlatBuilder : public ParseHandler {
+    private:
+        struct Open {
+            std::int32_t mIdx;
+            std::int32_t mLast;
+        };
+
+        FlatTree* mTree;
+        std::vector<Open> mOpen;
+        std::int32_t mLastTop;
+
+        std::int32_t add(const std::string&, std::size_t, std::size_t);
+
+    public:
+        FlatBuilder(FlatTree*);
+
+        void enterRule(const std::string&, std::size_t) override;
+        void leaf(const std::string&, std::string_view) override;
+        void exitRule(const std::string&, std::size_t) override;
+    };
+}
@@ -0,0 +1,56 @@
+#include <string>
+#include <string_view>
+#include "frozengrammar.h"
+#include "codetracker.h"
+#include "context.h"
+
+using namespace Iguana;
+
+FrozenGrammar::FrozenGrammar(GlobalParserTable* table, Parser* root)
+    : mTable(table), mRoot(root)
+{
+    if (mRoot == nullptr) {
+        auto it = mTable->mParsers.find("ROOT");
+
+        if (it == mTable->mParsers.end()) {
+            mError = "Grammar has no ROOT parser";
+            return;
+        }
+
+        mRoot = it->second;
+    }
+
+    const Parser* unassigned = mTable->findUnassigned();
+    if (unassigned != nullptr) {
+        mError = unassigned->mName + " Parser is unassigned";
+        return;
+    }
+
+    mTable->analyze();
+    mTable->freeze(mRoot);
+}
+
+bool FrozenGrammar::valid() const {
+    return mError.empty();
+}
+
+const std::string& FrozenGrammar::error() const {
+    return mError;
+}
+
+ParseResult* FrozenGrammar::parse(std::string_view text, ParseContext* ctx) const {
+    if (!valid()) {
+        ParseResult* res = new ParseResult();
+        return res->failure(mError);
+    }
+
+    CodeTracker trckr(text);
+    trckr.mCtx = ctx;
+
+    return mTable->run(mRoot, &trckr);
+}
+
+ParseResult* FrozenGrammar::parse(std::string_view text) const {
+    ParseContext ctx;
+    return parse(text, &ctx);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include "iguana.h"
+
+namespace Iguana {
+    class ParseContext;
+
+    // A grammar that can no longer change. It owns its parser table and
+    // marks the table and its parsers frozen, so assigning, memoizing,
+    // parallelizing, analyzing or adding parsers through pointers kept from
+    // before throws instead of racing with parses. It is checked and
+    // analyzed once up front. Parsing only reads the grammar;
+    // everything a parse changes lives in the ParseContext passed in, so
+    // any number of threads can share one FrozenGrammar as long as each
+    // brings its own context.
+    class FrozenGrammar {
+    private:
+        std::unique_ptr<GlobalParserTable> mTable;
+        Parser* mRoot;
+        std::string mError;
+
+    public:
+        // Takes ownership of the table. Without a root parser the table's
+        // ROOT is used.
+        FrozenGrammar(GlobalParserTable*, Parser* = nullptr);
+        FrozenGrammar(const FrozenGrammar&) = delete;
+        FrozenGrammar& operator=(const FrozenGrammar&) = delete;
+
+        bool valid() const;
+        const std::string& error() const;
+
+        // The text must outlive the result, which points into it.
+        ParseResult* parse(std::string_view, ParseContext*) const;
+        ParseResult* parse(std::string_view) const;
+    };
+}
@@ -1,30 +1,225 @@
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <sstream>
+#include <utility>
 #include <map>
 #include "codetracker.h"
 #include "iguana.h"
+#include "context.h"
+#include "arena.h"
+#include "compiledregex.h"
+#include "lineindex.h"
+#include "charclass.h"
+#include "vm.h"
+#include "firstset.h"
+#include "leftrecursion.h"
+#include "trie.h"
+#include "scan.h"
+#include "stream.h"
+#include "mappedfile.h"
 
 using namespace Iguana;
 
-Node::Node(int lin, int col, const std::string& name)
-    : mValue("")
+NodeList::Iterator::Iterator(const Node* node)
+    : mNode(node)
+{}
+
+const Node& NodeList::Iterator::operator*() const {
+    mNode->settle();
+    return *mNode;
+}
+
+const Node* NodeList::Iterator::operator->() const {
+    mNode->settle();
+    return mNode;
+}
+
+NodeList::Iterator& NodeList::Iterator::operator++() {
+    ++mNode;
+    return *this;
+}
+
+bool NodeList::Iterator::operator==(const Iterator& other) const {
+    return mNode == other.mNode;
+}
+
+bool NodeList::Iterator::operator!=(const Iterator& other) const {
+    return mNode != other.mNode;
+}
+
+NodeList::NodeList()
+    : mData(nullptr), mSize(0)
+{}
+
+NodeList::NodeList(const Node* data, std::size_t size)
+    : mData(data), mSize(size)
+{}
+
+NodeList::Iterator NodeList::begin() const {
+    return Iterator(mData);
+}
+
+NodeList::Iterator NodeList::end() const {
+    return Iterator(mData + mSize);
+}
+
+std::size_t NodeList::size() const {
+    return mSize;
+}
+
+bool NodeList::empty() const {
+    return mSize == 0;
+}
+
+const Node& NodeList::operator[](std::size_t idx) const {
+    mData[idx].settle();
+    return mData[idx];
+}
+
+const Node& NodeList::front() const {
+    return (*this)[0];
+}
+
+const Node& NodeList::back() const {
+    return (*this)[mSize - 1];
+}
+
+Node::Node(const std::string& name, const allocator_type& alloc)
+    : mValue(""), mName(name, alloc)
 {
-    mLin = lin;
-    mCol = col;
-    mName = name;
+    mLines = nullptr;
+    mStart = 0;
+    mEnd = 0;
+    mRevision = nullptr;
 }
 
-void Node::setNodes(std::vector<Node> nodes) {
-    mNodes = nodes;
+Node::Node(const Node& other, const allocator_type& alloc)
+    : mNodes(other.mNodes), mValue(other.mValue),
+    mName(other.mName, alloc), mLines(other.mLines),
+    mStart(other.mStart), mEnd(other.mEnd), mRevision(other.mRevision)
+{}
+
+Node::Node(Node&& other, const allocator_type& alloc)
+    : mNodes(other.mNodes), mValue(other.mValue),
+    mName(std::move(other.mName), alloc), mLines(other.mLines),
+    mStart(other.mStart), mEnd(other.mEnd), mRevision(other.mRevision)
+{}
+
+// The vector is moved into its own arena and never destroyed, so its
+// buffer becomes the array without copying the nodes.
+void Node::setNodes(std::pmr::vector<Node>&& nodes) {
+    if (nodes.empty()) {
+        mNodes = NodeList();
+        return;
+    }
+
+    std::pmr::polymorphic_allocator<std::pmr::vector<Node>> alloc(nodes.get_allocator());
+    std::pmr::vector<Node>* kept = alloc.allocate(1);
+    alloc.construct(kept, std::move(nodes));
+
+    mNodes = NodeList(kept->data(), kept->size());
 }
 
-void Node::setValue(std::string value) {
+void Node::setValue(std::string_view value) {
     mValue = value;
 }
 
-void Node::display(IndentTracker* trckr) {
+std::size_t Node::lin() const {
+    return mLines->line(mStart);
+}
+
+std::size_t Node::col() const {
+    return mLines->col(mStart);
+}
+
+// Children are shared with the memo table and other trees, but the values
+// only move to an owned copy of the same bytes, so they can be swapped in
+// place.
+void Node::materialize(std::pmr::memory_resource* mem) {
+    std::vector<Node*> stack{ this };
+
+    while (!stack.empty()) {
+        Node* n = stack.back();
+        stack.pop_back();
+
+        if (!n->mValue.empty()) {
+            char* owned = static_cast<char*>(mem->allocate(n->mValue.size(), 1));
+            n->mValue.copy(owned, n->mValue.size());
+            n->mValue = std::string_view(owned, n->mValue.size());
+        }
+
+        for (const Node& child : n->mNodes)
+            stack.push_back(const_cast<Node*>(&child));
+    }
+}
+
+// A reused node has to have been left alone by every edit since it was
+// built, so each edit either comes after all of it or moves all of it.
+// Nodes are shared, but settling gives the same answer wherever it is
+// done from, so they are updated in place.
+void Node::settle() const {
+    const Revision* rev = mRevision;
+    if (rev == nullptr || rev->mNext == nullptr)
+        return;
+
+    std::size_t start = mStart;
+    std::size_t end = mEnd;
+
+    for (; rev->mNext != nullptr; rev = rev->mNext) {
+        for (const Edit& e : rev->mEdits) {
+            if (start < e.mOldEnd)
+                continue;
+
+            start = start - e.mOldEnd + e.mNewEnd;
+            end = end - e.mOldEnd + e.mNewEnd;
+        }
+    }
+
+    Node* n = const_cast<Node*>(this);
+    n->mStart = start;
+    n->mEnd = end;
+    n->mRevision = rev;
+
+    if (mLines != nullptr)
+        n->mLines = rev->mLines;
+    if (!mValue.empty())
+        n->mValue = rev->mInput.substr(start, mValue.size());
+}
+
+// Copies a level at a time instead of recursing, so trees as deep as a
+// long left-recursive expression can be copied.
+Node* Node::clone(std::pmr::memory_resource* mem) const {
+    std::pmr::polymorphic_allocator<Node> alloc(mem);
+    settle();
+    Node* root = alloc.allocate(1);
+    alloc.construct(root, *this);
+
+    std::vector<Node*> stack{ root };
+
+    while (!stack.empty()) {
+        Node* n = stack.back();
+        stack.pop_back();
+        n->mRevision = nullptr;
+
+        if (n->mNodes.empty())
+            continue;
+
+        Node* data = alloc.allocate(n->mNodes.size());
+
+        for (std::size_t i = 0; i < n->mNodes.size(); i++) {
+            alloc.construct(data + i, n->mNodes[i]);
+            stack.push_back(data + i);
+        }
+
+        n->mNodes = NodeList(data, n->mNodes.size());
+    }
+
+    return root;
+}
+
+void Node::display(IndentTracker* trckr) const {
     std::string indent1 = trckr->getIndentStr();
 
     std::cout << indent1 << "{" << std::endl;
@@ -34,14 +229,14 @@ void Node::display(IndentTracker* trckr) {
     std::string indent2 = trckr->getIndentStr();
 
     std::cout << indent2 << "Name: " << this->mName << std::endl;
-    std::cout << indent2 << "Pos: " << "(" << mLin << "," << mCol << ")" << std::endl;
+    std::cout << indent2 << "Pos: " << "(" << lin() << "," << col() << ")" << std::endl;
 
     if (mValue != "") 
         std::cout << indent2  << "Value: " << mValue << std::endl;
 
     if (mNodes.size() != 0) {
         std::cout << indent2 << "Nodes :-" << std::endl;
-        for (Node &n : mNodes) {
+        for (const Node& n : mNodes) {
             n.display(trckr);
         }
     }
@@ -71,10 +266,32 @@ std::string IndentTracker::getIndentStr() {
     return std::string(mCurrentMag, ' ');
 }
 
+RuleResult::RuleResult(const allocator_type& alloc)
+    : mMsg(alloc)
+{
+    mNode = nullptr;
+    mError = false;
+}
+
+RuleResult* RuleResult::success(Node* node) {
+    mNode = node;
+    return this;
+}
+
+RuleResult* RuleResult::failure(std::string_view msg) {
+    mError = true;
+    mMsg = msg;
+    return this;
+}
+
 ParseResult::ParseResult() {
     mNode = nullptr;
     mError = false;
-    mMsg = "";
+    mArena = nullptr;
+}
+
+ParseResult::~ParseResult() {
+    delete mArena;
 }
 
 ParseResult* ParseResult::success(Node* node) {
@@ -82,12 +299,29 @@ ParseResult* ParseResult::success(Node* node) {
     return this;
 }
 
-ParseResult* ParseResult::failure(const std::string& msg) {
+ParseResult* ParseResult::failure(std::string_view msg) {
     mError = true;
     mMsg = msg;
     return this;
 }
 
+void ParseResult::materialize() {
+    if (mError || mNode == nullptr)
+        return;
+
+    // Without an arena of its own the tree belongs to the parse context,
+    // whose memo table shares it, so the result gets a copy to change.
+    if (mArena == nullptr) {
+        mArena = new Arena();
+        mNode = mNode->clone(mArena);
+    }
+
+    if (mLines != nullptr)
+        mLines->position(0);
+
+    mNode->materialize(mArena);
+}
+
 void ParseResult::displayResult() {
     if (mError) {
         std::cout << mMsg << std::endl;
@@ -102,495 +336,671 @@ void ParseResult::displayResult() {
 Parser::Parser()
     : mToParse(""), mName(""),
     mParseFn(nullptr), mType(PTypes::Unassigned),
-    mLowerAmt(0), mUpperAmt(0)
+    mLowerAmt(0), mUpperAmt(0), mMemoize(false),
+    mLeftRecursive(false), mCyclic(false), mFrozen(false), mThreads(0)
 {}
 
-std::string Parser::getError(const std::string& expected, int lin, int col) {
+RuleResult* Parser::fail(RuleResult* res, CodeTracker* trckr, std::size_t offset) {
+    trckr->mCtx->expect(this, offset);
+    return res->failure("");
+}
+
+std::string Parser::describeAll(const std::vector<const Parser*>& parsers) {
+    std::string expected;
+
+    for (const Parser* p : parsers) {
+        if (!expected.empty())
+            expected += " or ";
+        expected += p->describe();
+    }
+
+    return expected;
+}
+
+std::string Parser::getError(const std::string& expected, CodeTracker* trckr, std::size_t offset) {
+    LineIndex::Position pos = trckr->mLines->position(offset);
+
     std::ostringstream err;
     err << mName << " Parsing Error: Expected " << expected << " (" 
-        << lin << ":" << col << ")";
+        << pos.mLin << ":" << pos.mCol << ")";
     return err.str();
 }
 
-ParseResult* Parser::parse(CodeTracker* trckr) {
-    return (this->*mParseFn)(trckr);
+// Built once per failed parse from the farthest failure. Falls back to
+// the root's own description when nothing recorded an expectation.
+std::string Parser::failureMessage(CodeTracker* trckr, std::size_t begin) {
+    ParseContext* ctx = trckr->mCtx;
+
+    if (ctx->mExpected.empty()) {
+        std::string_view input = trckr->input();
+        std::size_t start = begin + scanWhitespace(input.data() + begin, input.data() + input.length());
+        return getError(describe(), trckr, start);
+    }
+
+    return getError(describeAll(ctx->mExpected), trckr, ctx->mFailPos);
 }
 
-ParseResult* Parser::parseString(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
-    trckr->skipWhitespace();
-    
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+// Stands in for a seed while the tree on top of it is parsed, so each
+// round of growing costs only the new nodes.
+static const char SEED_MARK = 0;
 
-    if (trckr->matchString(mToParse)) {
-        std::string nodeName = mName;
-        Node* pNode = new Node(trckr->mLin, trckr->mCol, nodeName);
-        pNode->setValue(mToParse);
-        trckr->consume(mToParse);
-        return res->success(pNode);
+RuleResult* Parser::parse(CodeTracker* trckr) {
+    if (mLeftRecursive) {
+        ParseContext* ctx = trckr->mCtx;
+
+        trckr->skipWhitespace();
+        std::size_t idx = trckr->mIdx;
+
+        for (auto seed = ctx->mSeeds.rbegin(); seed != ctx->mSeeds.rend(); ++seed) {
+            if (seed->mParser != this || seed->mPos != idx)
+                continue;
+
+            RuleResult* res = ctx->make<RuleResult>();
+            if (seed->mNode == nullptr)
+                return res->failure("");
+
+            trckr->restore(seed->mEnd);
+            Node* node = makeNode(trckr, idx);
+            node->mName = seed->mNode->mName;
+            node->mValue = std::string_view(&SEED_MARK, 0);
+            return res->success(node);
+        }
     }
 
-    return res->failure(this->getError("'" + mToParse + "'", lin, col));
-}
+    if (!mMemoize || mCyclic)
+        return parseRule(trckr);
 
-ParseResult* Parser::parseAnd(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+    ParseContext* ctx = trckr->mCtx;
 
     trckr->skipWhitespace();
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::size_t idx = trckr->mIdx;
 
-    std::vector<Node> nodes;
-    int idx = 0;
-    for (Parser* p : mParsers) {
-        int startLin = trckr->mLin;
-        int startCol = trckr->mCol;
-        ParseResult* pres = (p->*p->mParseFn)(trckr);
-        
-        if (pres->mError) {
-            return res->failure(this->getError(p->mName, startLin, startCol));
-        }
+    MemoEntry* entry = ctx->mMemo.find(this, idx);
+    if (entry != nullptr) {
+        ctx->mMemoHits++;
+        trckr->restore(entry->mEnd);
+        trckr->touch(entry->mReach);
 
-        if (toInclude[idx]) {
-            nodes.push_back(*pres->mNode);
-        } else {
-            delete pres->mNode;
-        }
+        for (std::size_t i = 0; i < entry->mExpectedCount; i++)
+            ctx->expect(entry->mExpected[i], entry->mFailPos);
 
-        delete pres;
-        ++idx;
+        RuleResult* res = ctx->make<RuleResult>();
+        if (entry->mResult->mError)
+            return res->failure(entry->mResult->mMsg);
+
+        return res->success(entry->mResult->mNode);
     }
 
-    std::string nodeName = mName;
+    ctx->mMemoMisses++;
 
-    Node* pNode = new Node(lin, col, nodeName);
-    pNode->setNodes(nodes);
+    // Measure this rule's own reach and failures, then fold them back into
+    // the caller's.
+    std::size_t reach = trckr->mReach;
+    std::size_t failPos = ctx->mFailPos;
+    std::vector<const Parser*> expected;
+    trckr->mReach = idx;
+    ctx->mFailPos = 0;
+    expected.swap(ctx->mExpected);
 
-    return res->success(pNode);
+    RuleResult* res = parseRule(trckr);
+    ctx->mMemo.store(this, idx, res, trckr);
+
+    trckr->touch(reach);
+    std::size_t innerPos = ctx->mFailPos;
+    expected.swap(ctx->mExpected);
+    ctx->mFailPos = failPos;
+
+    for (const Parser* p : expected)
+        ctx->expect(p, innerPos);
+
+    return res;
 }
 
-ParseResult* Parser::parseOr(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseRule(CodeTracker* trckr) {
+    if (mLeftRecursive)
+        return growSeed(trckr);
 
-    trckr->skipWhitespace();
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    return (this->*mParseFn)(trckr);
+}
 
-    Node* node = nullptr;
+// Puts the seed in place of its stand-ins in the tree grown on top of it.
+// They start where the seed does, so only that edge of the tree is walked.
+static void plantSeed(Node* tree, Node* seed, std::size_t start) {
+    std::vector<Node*> stack{ tree };
+    Node* planted = nullptr;
 
-    for (Parser* p : mParsers) {
-        CodeTracker* cloneTrckr = trckr->copy();
-        ParseResult* pres = (p->*p->mParseFn)(cloneTrckr);
+    while (!stack.empty()) {
+        Node* n = stack.back();
+        stack.pop_back();
 
-        if (pres->mError) {
-            delete pres;
-            delete cloneTrckr;
+        // Trees that hold stand-ins come from rules in the cycle, which are
+        // never memoized, so nothing else shares them.
+        if (n->mValue.data() != &SEED_MARK) {
+            for (const Node& child : n->mNodes) {
+                if (child.mStart == start)
+                    stack.push_back(const_cast<Node*>(&child));
+            }
             continue;
         }
 
-        node = pres->mNode;
-        trckr->mIdx = cloneTrckr->mIdx;
-        trckr->mLin = cloneTrckr->mLin;
-        trckr->mCol = cloneTrckr->mCol;
-        delete pres;
-        delete cloneTrckr;
-        break;
+        // An enclosing Or may have renamed the stand-in.
+        std::pmr::string name = n->mName;
+        if (planted == nullptr) {
+            *n = *seed;
+            planted = n;
+        } else {
+            *n = *planted;
+        }
+        n->mName = name;
     }
+}
 
-    if (node == nullptr) {
-        std::string expected = "one of ";
+// Parses a left-recursive rule the way Warth et al. grow a seed. The rule
+// first runs with its calls at this position failing, which leaves only
+// its other alternatives; each later round runs it again with those calls
+// returning the previous round's parse. Growing stops at the first round
+// that gets no further, and the longest parse wins. The recursion never
+// goes deeper than one round, and the tree leans left.
+RuleResult* Parser::growSeed(CodeTracker* trckr) {
+    ParseContext* ctx = trckr->mCtx;
 
-        bool first = true;
-        expected += "'" + mParsers[0]->mName + "'";
-        for (Parser* p : mParsers) {
-            if (first) {
-                first = false;
-                continue;
+    trckr->skipWhitespace();
+    CodeTracker::Checkpoint start = trckr->save();
+    std::size_t slot = ctx->mSeeds.size();
+    ctx->mSeeds.push_back(Seed{ this, start.mIdx, nullptr, start });
+
+    while (true) {
+        trckr->restore(start);
+        RuleResult* res = (this->*mParseFn)(trckr);
+        Seed& seed = ctx->mSeeds[slot];
+
+        if (res->mError || (seed.mNode != nullptr && trckr->mIdx <= seed.mEnd.mIdx))
+            break;
+
+        if (seed.mNode != nullptr)
+            plantSeed(res->mNode, seed.mNode, start.mIdx);
+
+        seed.mNode = res->mNode;
+        seed.mEnd = trckr->save();
+    }
+
+    Seed seed = ctx->mSeeds[slot];
+    ctx->mSeeds.pop_back();
+
+    RuleResult* res = ctx->make<RuleResult>();
+    if (seed.mNode == nullptr)
+        return res->failure("");
+
+    trckr->restore(seed.mEnd);
+    return res->success(seed.mNode);
+}
+
+std::string Parser::describe() const {
+    switch (mType) {
+        case PTypes::String:
+            return "'" + mToParse + "'";
+        case PTypes::Or: {
+            std::string expected = "one of ";
+
+            bool first = true;
+            expected += "'" + mParsers[0]->mName + "'";
+            for (Parser* p : mParsers) {
+                if (first) {
+                    first = false;
+                    continue;
+                }
+                expected += ", '" + p->mName + "'";
             }
-            expected += ", '" + p->mName + "'";
-        }
 
-        return res->failure(this->getError(expected, lin, col));
+            return expected;
+        }
+        case PTypes::Many:
+            return "one or more of '" + mName + "'";
+        case PTypes::Alphabetic:
+            return "alphabetic character";
+        case PTypes::Alphanumeric:
+            return "alphanumeric character";
+        case PTypes::Digit:
+            return "digit";
+        case PTypes::Custom:
+            return "one of " + mToParse;
+        case PTypes::Class:
+            return "character in " + mToParse;
+        case PTypes::EndOfFile:
+            return "end of file";
+        case PTypes::Until:
+            return mParsers[0]->mName;
+        case PTypes::Number:
+            return std::to_string(mLowerAmt) + " of " + mName;
+        case PTypes::Range:
+            return std::to_string(mLowerAmt)
+                + "-"
+                + std::to_string(mUpperAmt)
+                + " of "
+                + mName;
+        case PTypes::MoreThan:
+            return "More than "
+                + std::to_string(mLowerAmt)
+                + " of "
+                + mName;
+        case PTypes::LessThan:
+            return "less than "
+                + std::to_string(mUpperAmt)
+                + " of "
+                + mName;
+        default:
+            return mName;
     }
+}
 
-    std::string nodeName = mName;
-    Node* resNode;
-    if (node->mName != "") {
-        resNode = new Node(lin, col, nodeName);
-        resNode->setNodes(std::vector<Node>{ *node });
-    } else {
-        node->mName = nodeName;
-        resNode = node;
+Node* Parser::makeNode(CodeTracker* trckr, std::size_t start) {
+    ParseContext* ctx = trckr->mCtx;
+    Node* node = ctx->nodeArena()->make<Node>(mName);
+    node->mLines = trckr->mLines.get();
+    node->mStart = start;
+    node->mEnd = trckr->mIdx;
+    node->mRevision = ctx->mMemo.revision();
+    return node;
+}
+
+RuleResult* Parser::parseString(CodeTracker* trckr) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
+    trckr->skipWhitespace();
+    
+    std::size_t start = trckr->mIdx;
+
+    if (trckr->matchString(mToParse)) {
+        std::string_view matched = trckr->view(mToParse.length());
+        trckr->consume(matched);
+        Node* pNode = makeNode(trckr, start);
+        pNode->setValue(matched);
+        return res->success(pNode);
     }
 
-    return res->success(resNode);
+    return fail(res, trckr, start);
 }
 
-ParseResult* Parser::parseMany(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseAnd(CodeTracker* trckr) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
 
-    std::vector<Node> nodes;
     trckr->skipWhitespace();
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::size_t start = trckr->mIdx;
 
+    std::pmr::vector<Node> nodes(trckr->mCtx->nodeArena());
+    nodes.reserve(mParsers.size());
+    int idx = 0;
+    for (Parser* p : mParsers) {
+        RuleResult* pres = p->parse(trckr);
+        
+        if (pres->mError) {
+            return res->failure("");
+        }
 
-    Parser* p = mParsers[0];
-    while (true) {
-        CodeTracker* trckrClone = trckr->copy();
-        ParseResult* pres = (p->*p->mParseFn)(trckrClone);
-
-        if (pres->mError)
-            break;
+        if (toInclude[idx])
+            nodes.push_back(*pres->mNode);
 
-        trckr->copyInfo(trckrClone);
-        nodes.push_back(*pres->mNode);
-        delete pres;
-        delete trckrClone;
+        ++idx;
     }
 
-    if (nodes.size() == 0) {
-        std::string expected = "one or more of '" + mName + "'";
-        return res->failure(this->getError(expected, lin, col));
-    }
+    Node* pNode = makeNode(trckr, start);
+    pNode->setNodes(std::move(nodes));
+
+    return res->success(pNode);
+}
 
-    std::string nodeName = mName;
-    Node* resNode = new Node(lin, col, nodeName);
-    resNode->setNodes(nodes);
+RuleResult* Parser::parseOr(CodeTracker* trckr) {
+    FailureMark mark = trckr->mCtx->failureMark();
+    trckr->skipWhitespace();
+    std::size_t start = trckr->mIdx;
 
-    return res->success(resNode);
+    RuleResult* res = parseAlternatives(trckr, mParsers.data(), mParsers.data() + mParsers.size(), nullptr);
+    expectAlternatives(trckr, start, mark, false);
+
+    return res;
 }
 
-ParseResult* Parser::parseClosure(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseOrDispatch(CodeTracker* trckr) {
+    FailureMark mark = trckr->mCtx->failureMark();
+    trckr->skipWhitespace();
+    std::size_t start = trckr->mIdx;
 
+    std::string_view input = trckr->input();
+    int sym = start < input.length() ? static_cast<unsigned char>(input[start]) : 256;
+    int list = mDispatch->mTable[sym];
+
+    const std::vector<Parser*>& candidates = mDispatch->mLists[list];
+    int winner;
+    RuleResult* res = parseAlternatives(trckr, candidates.data(), candidates.data() + candidates.size(), &winner);
+
+    // Alternatives left out of the list would have failed right at start.
+    expectAlternatives(trckr, start, mark, mDispatch->mPruned[list][res->mError ? candidates.size() : winner]);
+
+    return res;
+}
+
+RuleResult* Parser::parseOrTrie(CodeTracker* trckr) {
+    FailureMark mark = trckr->mCtx->failureMark();
     trckr->skipWhitespace();
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::size_t start = trckr->mIdx;
 
-    ParseResult* pres = parseMany(trckr);
+    std::string_view input = trckr->input();
+    const char* stop;
+    int alt = mTrie->match(input.data() + start, input.data() + input.length(), &stop);
+    trckr->touch(stop - input.data());
 
-    std::string nodeName = mName;
-    Node* node = new Node(lin, col, nodeName);
+    RuleResult* res;
+    if (alt < 0)
+        res = parseAlternatives(trckr, nullptr, nullptr, nullptr);
+    else
+        res = parseAlternatives(trckr, &mParsers[alt], &mParsers[alt] + 1, nullptr);
 
-    if (!pres->mError)
-        node->setNodes(std::vector<Node>{ *pres->mNode });
+    expectAlternatives(trckr, start, mark, alt != 0);
 
-    delete pres;
-    return res->success(node);;
+    return res;
 }
 
-ParseResult* Parser::parseAlphabetic(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+// An Or reports itself in place of alternatives that failed at its start,
+// whether or not a later alternative matched.
+void Parser::expectAlternatives(CodeTracker* trckr, std::size_t start, FailureMark mark, bool skipped) {
+    ParseContext* ctx = trckr->mCtx;
+
+    if (skipped || ctx->failedSince(mark, start))
+        ctx->expect(this, start, mark);
+}
+
+RuleResult* Parser::parseAlternatives(CodeTracker* trckr, Parser* const* begin, Parser* const* end, int* winner) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
 
     trckr->skipWhitespace();
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::size_t start = trckr->mIdx;
 
-    std::string resstr = trckr->parseKey(std::isalpha);
+    Node* node = nullptr;
 
-    if (resstr == "") {
-        return res->failure(getError("alphabetic character", lin, col));
+    for (Parser* const* it = begin; it != end; ++it) {
+        Parser* p = *it;
+        CodeTracker::Checkpoint cp = trckr->save();
+        RuleResult* pres = p->parse(trckr);
+
+        if (pres->mError) {
+            trckr->restore(cp);
+            continue;
+        }
+
+        node = pres->mNode;
+        if (winner != nullptr)
+            *winner = it - begin;
+        break;
     }
 
-    std::string nodeName = mName;
-    Node* node = new Node(lin, col, nodeName);
-    node->setValue(resstr);
+    if (node == nullptr)
+        return res->failure("");
 
-    return res->success(node);
+    // The node may be shared through the memo table, so it is wrapped or
+    // renamed as a copy.
+    Node* resNode;
+    if (node->mName != "") {
+        std::pmr::vector<Node> nodes(1, *node, trckr->mCtx->nodeArena());
+        resNode = makeNode(trckr, start);
+        resNode->setNodes(std::move(nodes));
+    } else {
+        resNode = trckr->mCtx->nodeArena()->make<Node>(*node);
+        resNode->mName = mName;
+    }
+
+    return res->success(resNode);
 }
 
-ParseResult* Parser::parseAlphanumeric(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseMany(CodeTracker* trckr) {
+    // An incremental session keeps nodes across parses in an arena of its
+    // own, which the workers do not build in.
+    if (!mSync.empty() && !trckr->mCtx->mSerial && !trckr->mCtx->mRetain) {
+        RuleResult* res = parseManyParallel(trckr);
+        if (res != nullptr)
+            return res;
+    }
+
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
 
+    std::pmr::vector<Node> nodes(trckr->mCtx->nodeArena());
     trckr->skipWhitespace();
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::size_t start = trckr->mIdx;
 
-    std::string resstr = trckr->parseKey(std::isalnum);
 
-    if (resstr == "") {
-        return res->failure(getError("alphanumeric character", lin, col));
+    Parser* p = mParsers[0];
+    while (true) {
+        CodeTracker::Checkpoint cp = trckr->save();
+        RuleResult* pres = p->parse(trckr);
+
+        if (pres->mError) {
+            trckr->restore(cp);
+            break;
+        }
+
+        nodes.push_back(*pres->mNode);
     }
 
-    std::string nodeName = mName;
-    Node* node = new Node(lin, col, nodeName);
-    node->setValue(resstr);
+    if (nodes.size() == 0)
+        return res->failure("");
 
-    return res->success(node);
+    Node* resNode = makeNode(trckr, start);
+    resNode->setNodes(std::move(nodes));
+
+    return res->success(resNode);
 }
 
-ParseResult* Parser::parseDigit(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseClosure(CodeTracker* trckr) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
 
     trckr->skipWhitespace();
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::size_t start = trckr->mIdx;
 
-    std::string resstr = trckr->parseKey(std::isdigit);
+    RuleResult* pres = parseMany(trckr);
 
-    if (resstr == "") {
-        return res->failure(getError("digit", lin, col));
-    }
+    Node* node = makeNode(trckr, start);
 
-    std::string nodeName = mName;
-    Node* node = new Node(lin, col, nodeName);
-    node->setValue(resstr);
+    if (!pres->mError)
+        node->setNodes(std::pmr::vector<Node>(1, *pres->mNode, trckr->mCtx->nodeArena()));
 
-    return res->success(node);
+    return res->success(node);;
 }
 
-ParseResult* Parser::parseCustom(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseClass(CodeTracker* trckr) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
 
     trckr->skipWhitespace();
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::size_t start = trckr->mIdx;
 
-    std::string resstr = trckr->parseCustomSymbols(mToParse);
+    std::string_view resstr = trckr->parseClass(mClass);
 
     if (resstr == "") {
-        return res->failure(getError("one of " + mToParse, lin, col));
+        return fail(res, trckr, start);
     }
 
-    std::string nodeName = mName;
-    Node* node = new Node(lin, col, nodeName);
+    Node* node = makeNode(trckr, start);
     node->setValue(resstr);
 
     return res->success(node);
 }
 
-ParseResult* Parser::parseEOF(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseEOF(CodeTracker* trckr) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
     trckr->skipWhitespace();
 
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::size_t start = trckr->mIdx;
 
     if (!trckr->isEOF()) 
-        return res->failure(getError("end of file", lin, col));
+        return fail(res, trckr, start);
 
-    std::string nodeName = mName;
-    Node* node = new Node(lin, col, nodeName);
+    Node* node = makeNode(trckr, start);
 
     return res->success(node);
 }
 
-ParseResult* Parser::parseUntil(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseUntil(CodeTracker* trckr) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
     trckr->skipWhitespace();
 
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
-
-    std::vector<Node> nodes;
+    std::size_t start = trckr->mIdx;
 
+    // The node only spans what was skipped, so the items' nodes are not
+    // kept.
     Parser* toP = mParsers[0];
-    Parser* until = mParsers[0];
-
-    int indivLin = lin;
-    int indivCol = col;
+    Parser* until = mParsers[1];
 
     while (true) {
-        CodeTracker* trckrClone = trckr->copy();
-        ParseResult* ures = (until->*until->mParseFn)(trckrClone);
+        CodeTracker::Checkpoint cp = trckr->save();
+        RuleResult* ures = until->parse(trckr);
+        trckr->restore(cp);
 
-        bool isError = ures->mError;
-
-        delete trckrClone;
-        delete ures->mNode;
-        delete ures;
-
-        if (!isError) 
+        if (!ures->mError) 
             break;
 
         trckr->skipWhitespace();
-        indivLin = trckr->mLin;
-        indivCol = trckr->mCol;
-        
-        ParseResult* pres = (toP->*toP->mParseFn)(trckr);
+
+        RuleResult* pres = toP->parse(trckr);
 
         if (pres->mError) {
-            delete pres;
-            return res->failure(getError(toP->mName, lin, col));
+            return res->failure("");
         }
-
-        nodes.push_back(*pres->mNode);
-        delete pres;
     }
 
-    Node* resNode = new Node(lin, col, mName);
+    Node* resNode = makeNode(trckr, start);
 
     return res->success(resNode);
 }
 
-ParseResult* Parser::parseRegex(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseRegex(CodeTracker* trckr) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
     trckr->skipWhitespace();
 
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::size_t start = trckr->mIdx;
 
-    std::string resstring = trckr->parseRegex(mToParse);
+    std::string_view resstring = trckr->parseRegex(*mRegex);
 
     if (resstring == "") {
-        return res->failure(getError(mName, lin, col));
+        return fail(res, trckr, start);
     }
 
-    Node* resNode = new Node(lin, col, mName);
+    Node* resNode = makeNode(trckr, start);
     resNode->setValue(resstring);
 
     return res->success(resNode);
 }
 
-ParseResult* Parser::parseNumber(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseNumber(CodeTracker* trckr) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
 
-    std::vector<Node> nodes;
+    std::pmr::vector<Node> nodes(trckr->mCtx->nodeArena());
     trckr->skipWhitespace();
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::size_t start = trckr->mIdx;
 
     Parser* toP = mParsers[0];
+    nodes.reserve(mLowerAmt);
 
     for (int i = 0; i < mLowerAmt; i++) {
-        ParseResult* pres = (toP->*toP->mParseFn)(trckr);
+        RuleResult* pres = toP->parse(trckr);
 
         if (pres->mError) {
-            delete pres;
-            return res->failure(getError(std::to_string(mLowerAmt) + " of " + mName, lin, col));
+            return res->failure("");
         }
 
         nodes.push_back(*pres->mNode);
-        delete pres;
     }
 
-    Node* resNode = new Node(lin, col, mName);
-    resNode->setNodes(nodes);
+    Node* resNode = makeNode(trckr, start);
+    resNode->setNodes(std::move(nodes));
 
     return res->success(resNode);
 }
 
-ParseResult* Parser::parseRange(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseRange(CodeTracker* trckr) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
 
-    std::vector<Node> nodes;
+    std::pmr::vector<Node> nodes(trckr->mCtx->nodeArena());
     trckr->skipWhitespace();
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::size_t start = trckr->mIdx;
 
     Parser* toP = mParsers[0];
 
     for (int i = 0; i < mUpperAmt; i++) {
-        CodeTracker* trckrClone = trckr->copy();
-        ParseResult* pres = (toP->*toP->mParseFn)(trckrClone);
+        CodeTracker::Checkpoint cp = trckr->save();
+        RuleResult* pres = toP->parse(trckr);
 
         if (pres->mError) {
-            delete trckrClone;
-            delete pres;
+            trckr->restore(cp);
             break;
         }
 
         nodes.push_back(*pres->mNode);
-        trckr->copyInfo(trckrClone);
-        delete trckrClone;
-        delete pres;
     }
 
     if (nodes.size() >= mLowerAmt) {
-        Node* resNode = new Node(lin, col, mName);
-        resNode->setNodes(nodes);
+        Node* resNode = makeNode(trckr, start);
+        resNode->setNodes(std::move(nodes));
         return res->success(resNode);
     }
 
-    std::string expected = std::to_string(mLowerAmt)
-        + "-"
-        + std::to_string(mUpperAmt)
-        + " of "
-        + mName;
-
-    return res->failure(getError(expected, lin, col));
+    return res->failure("");
 }
 
-ParseResult* Parser::parseMoreThan(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseMoreThan(CodeTracker* trckr) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
 
     trckr->skipWhitespace();
-    std::vector<Node> nodes;
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::pmr::vector<Node> nodes(trckr->mCtx->nodeArena());
+    std::size_t start = trckr->mIdx;
 
     Parser* toP = mParsers[0];
 
     while (true) {
-        CodeTracker* trckrClone = trckr->copy();
-        ParseResult* pres = (toP->*toP->mParseFn)(trckrClone);
+        CodeTracker::Checkpoint cp = trckr->save();
+        RuleResult* pres = toP->parse(trckr);
 
         if (pres->mError) {
-            delete trckrClone;
-            delete pres;
+            trckr->restore(cp);
             break;
         }
 
         nodes.push_back(*pres->mNode);
-        trckr->copyInfo(trckrClone);
-        delete trckrClone;
-        delete pres;
     }
 
     if (nodes.size() > mLowerAmt) {
-        Node* resNode = new Node(lin, col, mName);
-        resNode->setNodes(nodes);
+        Node* resNode = makeNode(trckr, start);
+        resNode->setNodes(std::move(nodes));
         return res->success(resNode);
     }
 
-    std::string expected = "More than "
-        + std::to_string(mLowerAmt)
-        + " of "
-        + mName;
-
-    return res->failure(getError(expected, lin, col));
+    return res->failure("");
 }
 
-ParseResult* Parser::parseLessThan(CodeTracker* trckr) {
-    ParseResult* res = new ParseResult();
+RuleResult* Parser::parseLessThan(CodeTracker* trckr) {
+    RuleResult* res = trckr->mCtx->make<RuleResult>();
 
     trckr->skipWhitespace();
-    std::vector<Node> nodes;
-    int lin = trckr->mLin;
-    int col = trckr->mCol;
+    std::pmr::vector<Node> nodes(trckr->mCtx->nodeArena());
+    std::size_t start = trckr->mIdx;
 
     Parser* toP = mParsers[0];
 
     for (int i = 1; i < mUpperAmt; i++) {
-        CodeTracker* trckrClone = trckr->copy();
-        ParseResult* pres = (toP->*toP->mParseFn)(trckr);
+        CodeTracker::Checkpoint cp = trckr->save();
+        RuleResult* pres = toP->parse(trckr);
 
         if (pres->mError) {
-            delete trckrClone;
-            delete pres;
+            trckr->restore(cp);
             break;
         }
 
         nodes.push_back(*pres->mNode);
-        trckr->copyInfo(trckrClone);
-        delete trckrClone;
-        delete pres;
     }
 
     if (nodes.size() > 0) {
-        Node* resNode = new Node(lin, col, mName);
-        resNode->setNodes(nodes);
+        Node* resNode = makeNode(trckr, start);
+        resNode->setNodes(std::move(nodes));
         return res->success(resNode);
     }
 
-    std::string expected = "less than "
-        + std::to_string(mUpperAmt)
-        + " of "
-        + mName;
-
-    return res->failure(getError(expected, lin, col));
+    return res->failure("");
 }
 
 Parser* Parser::String(const std::string& toParse, const std::string& name) {
@@ -662,7 +1072,8 @@ Parser* Parser::Alphabetic(const std::string& name) {
     Parser* p = new Parser();
     p->mName = name;
     p->mType = PTypes::Alphabetic;
-    p->mParseFn = &Parser::parseAlphabetic;
+    p->mClass = CharClass::alpha();
+    p->mParseFn = &Parser::parseClass;
     return p;
 }
 
@@ -670,7 +1081,8 @@ Parser* Parser::Alphanumeric(const std::string& name) {
     Parser* p = new Parser();
     p->mName = name;
     p->mType = PTypes::Alphanumeric;
-    p->mParseFn = &Parser::parseAlphanumeric;
+    p->mClass = CharClass::alnum();
+    p->mParseFn = &Parser::parseClass;
     return p;
 }
 
@@ -678,7 +1090,8 @@ Parser* Parser::Digit(const std::string& name) {
     Parser* p = new Parser();
     p->mName = name;
     p->mType = PTypes::Digit;
-    p->mParseFn = &Parser::parseDigit;
+    p->mClass = CharClass::digit();
+    p->mParseFn = &Parser::parseClass;
     return p;
 }
 
@@ -687,7 +1100,22 @@ Parser* Parser::Custom(const std::string& name, const std::string& toParse) {
     p->mName = name;
     p->mToParse = toParse;
     p->mType = PTypes::Custom;
-    p->mParseFn = &Parser::parseCustom;
+    p->mClass = CharClass::members(toParse);
+    p->mParseFn = &Parser::parseClass;
+    return p;
+}
+
+Parser* Parser::Class(const std::string& name, const std::string& spec) {
+    CharClass cls(spec);
+    if (!cls.valid())
+        throw "Invalid character class";
+
+    Parser* p = new Parser();
+    p->mName = name;
+    p->mToParse = spec;
+    p->mType = PTypes::Class;
+    p->mClass = cls;
+    p->mParseFn = &Parser::parseClass;
     return p;
 }
 
@@ -714,6 +1142,7 @@ Parser* Parser::Regex(const std::string& name, const std::string& regex) {
     p->mName = name;
     p->mType = PTypes::Regex;
     p->mToParse = regex;
+    p->mRegex = std::make_shared<const CompiledRegex>(regex);
     p->mParseFn = &Parser::parseRegex;
     return p;
 }
@@ -765,14 +1194,43 @@ Parser* Parser::Empty() {
 }
 
 void Parser::assign(Parser* other) {
+    if (mFrozen)
+        throw "Parser is frozen";
+
     if (mType != PTypes::Unassigned)
         return;
 
     mParsers = other->mParsers;
     mToParse = other->mToParse;
     mName = other->mName;
+    toInclude = other->toInclude;
     mType = other->mType;
+    mLowerAmt = other->mLowerAmt;
+    mUpperAmt = other->mUpperAmt;
     mParseFn = other->mParseFn;
+    mRegex = other->mRegex;
+    mClass = other->mClass;
+    mDispatch = other->mDispatch;
+    mTrie = other->mTrie;
+}
+
+void Parser::memoize(bool enable) {
+    if (mFrozen)
+        throw "Parser is frozen";
+
+    mMemoize = enable;
+}
+
+bool Parser::isMemoized() {
+    return mMemoize;
+}
+
+void Parser::parallelize(const std::string& sync, unsigned int threads) {
+    if (mFrozen)
+        throw "Parser is frozen";
+
+    mSync = sync;
+    mThreads = threads;
 }
 
 void Parser::assignParserFunction() {
@@ -788,8 +1246,12 @@ void Parser::assignParserFunction() {
 }
 
 
+GlobalParserTable::GlobalParserTable()
+    : mResolved(false), mFrozen(false)
+{}
+
 GlobalParserTable::~GlobalParserTable() {
-    for (std::pair<std::string, Parser*> const &p : mParsers)
+    for (const auto& p : mParsers)
         delete p.second;
 
     for (Parser* p : mAnonParsers)
@@ -799,125 +1261,387 @@ GlobalParserTable::~GlobalParserTable() {
 Parser* GlobalParserTable::String(const std::string& name, const std::string& toParse) {
     Parser* p = Parser::String(toParse, name);
     if (name == "")
-        mAnonParsers.push_back(p);
+        addAnonParser(p);
     else
-        mParsers.insert(std::pair<std::string, Parser*>(name, p));
+        add(name, p);
 
     return p;
 }
 
 Parser* GlobalParserTable::And(const std::string& name, std::vector<Parser*> parsers) {
     Parser* p = Parser::And(parsers, name);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::Or(const std::string& name, std::vector<Parser*> parsers) {
     Parser* p = Parser::Or(parsers, name);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::Many(const std::string& name, Parser* toParse) {
     Parser* p = Parser::Many(toParse, name);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::Closure(const std::string& name, Parser* toParse) {
     Parser* p = Parser::Closure(toParse, name);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::Alphabetic(const std::string& name) {
     Parser* p = Parser::Alphabetic(name);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::Alphanumeric(const std::string& name) {
     Parser* p = Parser::Alphanumeric(name);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::Digit(const std::string& name) {
     Parser* p = Parser::Digit(name);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::Custom(const std::string& name, const std::string& toParse) {
     Parser* p = Parser::Custom(name, toParse);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
+    return p;
+}
+
+Parser* GlobalParserTable::Class(const std::string& name, const std::string& spec) {
+    Parser* p = Parser::Class(name, spec);
+    add(name, p);
+    return p;
+}
+
+Parser* GlobalParserTable::Until(const std::string& name, Parser* toParse, Parser* until) {
+    Parser* p = Parser::Until(name, toParse, until);
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::EndOfFile(const std::string& name) {
     Parser* p = Parser::EndOfFile(name);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::Regex(const std::string& name, const std::string& regex) {
     Parser* p = Parser::Regex(name, regex);    
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::Number(const std::string& name, Parser* toP, unsigned int num) {
     Parser* p = Parser::Number(name, toP, num);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::Range(const std::string& name, Parser* toP, unsigned int l, unsigned int h) {
     Parser* p = Parser::Range(name, toP, l, h);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::MoreThan(const std::string& name, Parser* toP, unsigned int l) {
     Parser* p = Parser::MoreThan(name, toP, l);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::LessThan(const std::string& name, Parser* toP, unsigned int h) {
     Parser* p = Parser::LessThan(name, toP, h);
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 Parser* GlobalParserTable::Empty(const std::string& name) {
     Parser* p = Parser::Empty();
-    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    add(name, p);
     return p;
 }
 
 ParseResult* GlobalParserTable::parse(Parser* mainP, CodeTracker* trckr) {
-    for (std::pair<std::string, Parser*> const &p : mParsers) {
-        if (p.second->mType == PTypes::Unassigned) {
+    ParseResult* res = check();
+    if (res != nullptr)
+        return res;
+
+    return run(mainP, trckr);
+}
+
+// Returns a failed result when the grammar cannot be parsed with.
+ParseResult* GlobalParserTable::check() {
+    const Parser* unassigned = findUnassigned();
+
+    if (unassigned != nullptr) {
+        ParseResult* res = new ParseResult();
+        return res->failure(unassigned->mName + " Parser is unassigned");
+    }
+
+    // Parsing only reads the grammar, so that threads can share a table.
+    // A grammar without left recursion needs no flags set; one with it has
+    // to go through analyze() again.
+    if (!mResolved) {
+        std::vector<Parser*> parsers = mAnonParsers;
+        for (const auto& p : mParsers)
+            parsers.push_back(p.second);
+
+        if (!LeftRecursion(parsers).leaders().empty()) {
             ParseResult* res = new ParseResult();
-            return res->failure(p.second->mName + " Parser is unassigned");
+            return res->failure("Grammar is left recursive and has changed since analyze()");
         }
+
+        mResolved = true;
+    }
+
+    return nullptr;
+}
+
+const Parser* GlobalParserTable::findUnassigned() const {
+    for (const auto& p : mParsers) {
+        if (p.second->mType == PTypes::Unassigned)
+            return p.second;
+    }
+
+    return nullptr;
+}
+
+ParseResult* GlobalParserTable::run(Parser* mainP, CodeTracker* trckr) const {
+    ParseContext localCtx;
+    ParseContext* ctx = trckr->mCtx;
+    if (ctx == nullptr) {
+        ctx = &localCtx;
+        trckr->mCtx = ctx;
     }
 
-    return mainP->parse(trckr);
+    ctx->clearFailures();
+    ctx->mSeeds.clear();
+    std::size_t begin = trckr->mIdx;
+
+    RuleResult* pres = mainP->parse(trckr);
+
+    ParseResult* res = new ParseResult();
+    res->mNode = pres->mNode;
+    res->mError = pres->mError;
+
+    if (!res->mError)
+        res->mNode->settle();
+    res->mMsg = pres->mMsg;
+
+    if (res->mError)
+        res->mMsg = mainP->failureMessage(trckr, begin);
+    res->mArena = ctx->mRetain ? nullptr : ctx->release();
+    res->mLines = trckr->mLines;
+
+    if (ctx == &localCtx)
+        trckr->mCtx = nullptr;
+
+    return res;
 }
 
 ParseResult* GlobalParserTable::parseRoot(CodeTracker* trckr) {
     Parser* root = mParsers["ROOT"];
-    return root->parse(trckr);
+    return parse(root, trckr);
+}
+
+ParseResult* GlobalParserTable::parseFile(Parser* mainP, const std::string& path) {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(path);
+
+    if (!file->valid()) {
+        ParseResult* res = new ParseResult();
+        return res->failure(file->error());
+    }
+
+    CodeTracker trckr(file->view());
+    ParseResult* res = parse(mainP, &trckr);
+    res->mSource = file;
+
+    return res;
+}
+
+// Each item is parsed against the bytes already in the window. If any scan
+// reached the end of the window the item is parsed again with more input,
+// so results never depend on where a chunk happened to end.
+ParseResult* GlobalParserTable::parseEach(Parser* item, StreamSource* src,
+                                          const std::function<bool(ParseResult*)>& onItem) {
+    ParseResult* invalid = check();
+    if (invalid != nullptr)
+        return invalid;
+
+    std::string* window = src->window();
+
+    while (true) {
+        do {
+            const char* live = window->data() + src->start();
+            src->discard(scanWhitespace(live, window->data() + window->length()));
+        } while (src->start() == window->length() && src->fill(src->chunk()));
+
+        if (src->start() == window->length())
+            return nullptr;
+
+        std::size_t start = src->start();
+        ParseResult* res;
+        std::size_t end;
+
+        while (true) {
+            CodeTracker trckr(window);
+            trckr.mIdx = start;
+            trckr.mLines = src->lines();
+
+            res = run(item, &trckr);
+            end = trckr.mIdx;
+
+            if (trckr.mReach < window->length() || !src->fill(std::max(src->chunk(), window->length() - start)))
+                break;
+
+            delete res;
+        }
+
+        if (res->mError)
+            return res;
+
+        if (end == start) {
+            CodeTracker trckr(window);
+            trckr.mLines = res->mLines;
+            res->failure(item->getError(item->describe(), &trckr, start));
+            return res;
+        }
+
+        res->mLines->limit(end);
+        res->materialize();
+
+        // Discarding may move the window, and base() with it, so the item
+        // is handed over first.
+        bool more = onItem(res);
+        src->discard(end - start);
+
+        if (!more)
+            return nullptr;
+    }
+}
+
+Program* GlobalParserTable::compile(Parser* mainP) {
+    return Program::compile(mainP);
+}
+
+Program* GlobalParserTable::compileRoot() {
+    return compile(mParsers["ROOT"]);
+}
+
+void GlobalParserTable::analyze() {
+    if (mFrozen)
+        throw "Grammar is frozen";
+
+    std::vector<Parser*> parsers = mAnonParsers;
+    for (const auto& p : mParsers)
+        parsers.push_back(p.second);
+
+    FirstSets sets(parsers);
+    resolveLeftRecursion();
+
+    for (Parser* p : parsers) {
+        if (p->mType != PTypes::Or)
+            continue;
+
+        p->mTrie = nullptr;
+        p->mDispatch = nullptr;
+
+        std::vector<std::string> literals;
+        for (Parser* child : p->mParsers) {
+            if (child->mType != PTypes::String)
+                break;
+
+            literals.push_back(child->mToParse);
+        }
+
+        if (literals.size() > 1 && literals.size() == p->mParsers.size()) {
+            p->mTrie = std::make_shared<const LiteralTrie>(literals);
+            p->mParseFn = &Parser::parseOrTrie;
+            continue;
+        }
+
+        p->mDispatch = sets.dispatch(p);
+        p->mParseFn = p->mDispatch ? &Parser::parseOrDispatch : &Parser::parseOr;
+    }
+}
+
+void GlobalParserTable::resolveLeftRecursion() {
+    std::vector<Parser*> parsers = mAnonParsers;
+    for (const auto& p : mParsers)
+        parsers.push_back(p.second);
+
+    LeftRecursion(parsers).mark();
+    mResolved = true;
+}
+
+void GlobalParserTable::memoize(const std::string& name, bool enable) {
+    auto it = mParsers.find(name);
+
+    if (it != mParsers.end())
+        it->second->memoize(enable);
+}
+
+void GlobalParserTable::parallelize(const std::string& name, const std::string& sync, unsigned int threads) {
+    auto it = mParsers.find(name);
+
+    if (it != mParsers.end())
+        it->second->parallelize(sync, threads);
+}
+
+void GlobalParserTable::add(const std::string& name, Parser* p) {
+    if (mFrozen) {
+        delete p;
+        throw "Grammar is frozen";
+    }
+
+    mParsers.insert(std::pair<std::string, Parser*>(name, p));
+    mResolved = false;
 }
 
 void GlobalParserTable::addAnonParser(Parser* p) {
+    if (mFrozen)
+        throw "Grammar is frozen";
+
     mAnonParsers.push_back(p);
+    mResolved = false;
+}
+
+// Marks every parser reachable from the table, and the table itself, so
+// that changing them throws from then on.
+void GlobalParserTable::freeze(Parser* root) {
+    std::vector<Parser*> stack = mAnonParsers;
+    for (const auto& p : mParsers)
+        stack.push_back(p.second);
+    if (root != nullptr)
+        stack.push_back(root);
+
+    while (!stack.empty()) {
+        Parser* p = stack.back();
+        stack.pop_back();
+
+        if (p->mFrozen)
+            continue;
+
+        p->mFrozen = true;
+        for (Parser* child : p->mParsers)
+            stack.push_back(child);
+    }
+
+    mFrozen = true;
 }
 
 void GlobalParserTable::assign(Parser* to, Parser* from) {
     to->assign(from);
+    mResolved = false;
 }
 
 GlobalParserTable* GlobalParserTable::parseFromFile(const std::string& file) {
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory>
+#include <memory_resource>
 #include "codetracker.h"
+#include "charclass.h"
 #include <map>
 
 namespace Iguana {
@@ -18,29 +24,135 @@ namespace Iguana {
         std::string getIndentStr();
     };
 
+    class Arena;
+    class CompiledRegex;
+    class LineIndex;
+    class Program;
+    class FirstSets;
+    struct OrDispatch;
+    class LiteralTrie;
+    class StreamSource;
+    class MappedFile;
+    struct FailureMark;
+    struct Revision;
+
+    class Node;
+
+    // The children of a Node: a read-only array in the arena the tree was
+    // built in. Copying a Node shares the array instead of copying it, so
+    // a subtree can sit in the memo table and in any number of parents.
+    // Every node it hands out is settled first.
+    class NodeList {
+    private:
+        const Node* mData;
+        std::size_t mSize;
+
+    public:
+        class Iterator {
+        private:
+            const Node* mNode;
+
+        public:
+            Iterator(const Node*);
+
+            const Node& operator*() const;
+            const Node* operator->() const;
+            Iterator& operator++();
+            bool operator==(const Iterator&) const;
+            bool operator!=(const Iterator&) const;
+        };
+
+        NodeList();
+        NodeList(const Node*, std::size_t);
+
+        Iterator begin() const;
+        Iterator end() const;
+        std::size_t size() const;
+        bool empty() const;
+        const Node& operator[](std::size_t) const;
+        const Node& front() const;
+        const Node& back() const;
+    };
+
     class Node {
     public:
-        std::vector<Node> mNodes;
-        std::string mValue;
-        std::string mName;
-        int mLin;
-        int mCol;
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+        NodeList mNodes;
+        std::string_view mValue;
+        std::pmr::string mName;
+        LineIndex* mLines;
+        std::size_t mStart;
+        std::size_t mEnd;
+
+        // Parse of an incremental session the offsets above belong to;
+        // nullptr outside one.
+        const Revision* mRevision;
+
+        Node(const std::string&, const allocator_type& = {});
+        Node(const Node&, const allocator_type& = {});
+        Node(Node&&) = default;
+        Node(Node&&, const allocator_type&);
+        Node& operator=(const Node&) = default;
+        Node& operator=(Node&&) = default;
+
+        // Takes over the vector's buffer, which must come from an arena.
+        void setNodes(std::pmr::vector<Node>&&);
+        void setValue(std::string_view);
+        std::size_t lin() const;
+        std::size_t col() const;
+        void materialize(std::pmr::memory_resource*);
+        void display(IndentTracker*) const;
+
+        // Brings the offsets, value and line index of a node kept from an
+        // earlier parse of an incremental session up to date with the
+        // latest one. Only needed for a node not reached through a
+        // NodeList.
+        void settle() const;
+
+        // Copies the whole tree into mem, so it shares no children with
+        // the tree it came from, nor anything with an incremental session.
+        Node* clone(std::pmr::memory_resource*) const;
+    };
+
+    // What each parser hands back while a parse runs. It is placed in the
+    // parse context's arena and never destroyed, so it holds nothing the
+    // arena does not own.
+    class RuleResult {
+    public:
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
 
-        Node(int, int, const std::string&);
-        void setNodes(std::vector<Node>);
-        void setValue(std::string);
-        void display(IndentTracker*);
+        Node* mNode;
+        bool mError;
+        std::pmr::string mMsg;
+
+        RuleResult(const allocator_type& = {});
+
+        RuleResult* success(Node*);
+        RuleResult* failure(std::string_view);
     };
 
+    // The outcome of a whole parse, owned by the caller. Not for arenas:
+    // it frees its own arena and shares the line index and input.
     class ParseResult {
     public:
         Node* mNode;
         bool mError;
-        std::string mMsg;
+        std::pmr::string mMsg;
+        Arena* mArena;
+        std::shared_ptr<LineIndex> mLines;
+
+        // Input the tree points into, when the result has to keep it alive.
+        std::shared_ptr<MappedFile> mSource;
 
         ParseResult();
+        ParseResult(const ParseResult&) = delete;
+        ParseResult& operator=(const ParseResult&) = delete;
+        ~ParseResult();
+
         ParseResult* success(Node*);
-        ParseResult* failure(const std::string&);
+        ParseResult* failure(std::string_view);
+        void materialize();
         void displayResult();
     };
 
@@ -62,6 +174,7 @@ namespace Iguana {
         Range,
         MoreThan,
         LessThan,
+        Class,
     };
 
     class Parser {
@@ -70,29 +183,48 @@ namespace Iguana {
         std::string mToParse;
         std::string mName;
         std::vector<bool> toInclude;
-        ParseResult* (Parser::*mParseFn)(CodeTracker*);
+        RuleResult* (Parser::*mParseFn)(CodeTracker*);
         PTypes mType;
         unsigned int mLowerAmt;
         unsigned int mUpperAmt;
+        bool mMemoize;
+        bool mLeftRecursive;
+        bool mCyclic;
+        bool mFrozen;
+        std::string mSync;
+        unsigned int mThreads;
+        std::shared_ptr<const CompiledRegex> mRegex;
+        CharClass mClass;
+        std::shared_ptr<const OrDispatch> mDispatch;
+        std::shared_ptr<const LiteralTrie> mTrie;
 
-        std::string getError(const std::string&, int, int);
-        ParseResult* parseString(CodeTracker*);
-        ParseResult* parseAnd(CodeTracker*);
-        ParseResult* parseOr(CodeTracker*);
-        ParseResult* parseMany(CodeTracker*);
-        ParseResult* parseClosure(CodeTracker*);
-        ParseResult* parse(CodeTracker*);
-        ParseResult* parseAlphabetic(CodeTracker*);
-        ParseResult* parseAlphanumeric(CodeTracker*);
-        ParseResult* parseDigit(CodeTracker*);
-        ParseResult* parseCustom(CodeTracker*);
-        ParseResult* parseEOF(CodeTracker*);
-        ParseResult* parseUntil(CodeTracker*);
-        ParseResult* parseRegex(CodeTracker*);
-        ParseResult* parseNumber(CodeTracker*);
-        ParseResult* parseRange(CodeTracker*);
-        ParseResult* parseMoreThan(CodeTracker*);
-        ParseResult* parseLessThan(CodeTracker*);
+        std::string getError(const std::string&, CodeTracker*, std::size_t);
+        std::string failureMessage(CodeTracker*, std::size_t);
+        std::string describe() const;
+        static std::string describeAll(const std::vector<const Parser*>&);
+        RuleResult* fail(RuleResult*, CodeTracker*, std::size_t);
+        void expectAlternatives(CodeTracker*, std::size_t, FailureMark, bool);
+        Node* makeNode(CodeTracker*, std::size_t);
+        RuleResult* parseString(CodeTracker*);
+        RuleResult* parseAnd(CodeTracker*);
+        RuleResult* parseOr(CodeTracker*);
+        RuleResult* parseOrDispatch(CodeTracker*);
+        RuleResult* parseOrTrie(CodeTracker*);
+        RuleResult* parseAlternatives(CodeTracker*, Parser* const*, Parser* const*, int*);
+        RuleResult* parseMany(CodeTracker*);
+        RuleResult* parseManyParallel(CodeTracker*);
+        RuleResult* parseClosure(CodeTracker*);
+        RuleResult* parse(CodeTracker*);
+        RuleResult* parseRule(CodeTracker*);
+        RuleResult* growSeed(CodeTracker*);
+        RuleResult* parseClass(CodeTracker*);
+        RuleResult* parseEOF(CodeTracker*);
+        RuleResult* parseUntil(CodeTracker*);
+        RuleResult* parseRegex(CodeTracker*);
+        RuleResult* parseNumber(CodeTracker*);
+        RuleResult* parseRange(CodeTracker*);
+        RuleResult* parseMoreThan(CodeTracker*);
+        RuleResult* parseLessThan(CodeTracker*);
 
         void assignParserFunction();
 
@@ -100,12 +232,16 @@ namespace Iguana {
 
     public:
         void assign(Parser*);
+        void memoize(bool = true);
+        bool isMemoized();
+        void parallelize(const std::string&, unsigned int = 0);
         static Parser* Many(Parser*, const std::string&);
         static Parser* Closure(Parser*, const std::string&);
         static Parser* Alphabetic(const std::string&);
         static Parser* Alphanumeric(const std::string&);
         static Parser* Digit(const std::string&);
         static Parser* Custom(const std::string&, const std::string&);
+        static Parser* Class(const std::string&, const std::string&);
         static Parser* EndOfFile(const std::string&);
         static Parser* Until(const std::string&, Parser*, Parser*);
         static Parser* Number(const std::string&, Parser*, unsigned int);
@@ -119,6 +255,10 @@ namespace Iguana {
         static Parser* Or(std::vector<Parser*>, const std::string&);
         static Parser* Regex(const std::string&, const std::string&);
         friend class GlobalParserTable;
+        friend class Program;
+        friend class FirstSets;
+        friend class LeftRecursion;
+        friend class FrozenGrammar;
     };
 
     class GlobalParserTable {
@@ -126,9 +266,23 @@ namespace Iguana {
         std::map<std::string, Parser*> mParsers;
         std::vector<Parser*> mAnonParsers;
 
+        // Whether the parsers' left-recursion flags fit the grammar. Every
+        // change through the table clears it.
+        std::atomic<bool> mResolved;
+        bool mFrozen;
+
         static GlobalParserTable* getFileParser();
 
+        void add(const std::string&, Parser*);
+        void resolveLeftRecursion();
+        void freeze(Parser*);
+
+        const Parser* findUnassigned() const;
+        ParseResult* check();
+        ParseResult* run(Parser*, CodeTracker*) const;
+
     public:
+        GlobalParserTable();
         ~GlobalParserTable();
 
         static GlobalParserTable* parseFromFile(const std::string&);
@@ -142,6 +296,7 @@ namespace Iguana {
         Parser* Alphanumeric(const std::string&);
         Parser* Digit(const std::string&);
         Parser* Custom(const std::string&, const std::string&);
+        Parser* Class(const std::string&, const std::string&);
         Parser* Until(const std::string&, Parser*, Parser*);
         Parser* EndOfFile(const std::string&);
         Parser* Regex(const std::string&, const std::string&);
@@ -154,9 +309,46 @@ namespace Iguana {
         void addAnonParser(Parser*);
 
         void assign(Parser*, Parser*);
+        void memoize(const std::string&, bool = true);
+
+        // Parses the Many with this name on several threads. The input is
+        // cut into chunks just after occurrences of sync, each chunk is
+        // parsed on its own, and the items are joined in order. A chunk
+        // whose cut turns out not to fall between items is parsed again
+        // serially, so the tree is the one a serial parse would give.
+        // Meant for a repetition that runs to the end of the input, such as
+        // the records of ROOT. The chunks run on the ParseContext's
+        // WorkerPool; threads caps how many of its threads take part, and
+        // 0 lets all of them. An IncrementalParser parses it serially.
+        void parallelize(const std::string&, const std::string&, unsigned int = 0);
+
+        // Computes FIRST sets over the table and switches each Or to a
+        // per-byte dispatch over the alternatives that can match, or to a
+        // literal trie when every alternative is a String. Also marks the
+        // rules that are left recursive; parse() only reads the grammar,
+        // and fails on a left-recursive one that has changed since. Call
+        // again after changing the grammar.
+        void analyze();
 
         ParseResult* parse(Parser*, CodeTracker*);
         ParseResult* parseRoot(CodeTracker*);
+
+        // Maps the file read-only and parses it in place, without reading
+        // it into a string first.
+        ParseResult* parseFile(Parser*, const std::string&);
+
+        // Parses consecutive items from a stream, handing each result to
+        // the callback, which takes ownership. Stops at the end of input or
+        // when the callback returns false, returning nullptr, or at the
+        // first item that fails, returning its result. Node offsets are
+        // into the stream's window: adding src->base(), read inside the
+        // callback, gives offsets into the whole input.
+        ParseResult* parseEach(Parser*, StreamSource*, const std::function<bool(ParseResult*)>&);
+
+        Program* compile(Parser*);
+        Program* compileRoot();
+
+        friend class FrozenGrammar;
     };
 
     class ParserConstructor {
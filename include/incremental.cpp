@@ -0,0 +1,37 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include "incremental.h"
+#include "codetracker.h"
+#include "context.h"
+
+using namespace Iguana;
+
+IncrementalParser::IncrementalParser(GlobalParserTable* table, Parser* root)
+    : mTable(table), mRoot(root), mCtx(new ParseContext())
+{
+    mCtx->mRetain = true;
+}
+
+ParseResult* IncrementalParser::parse(std::string* doc) {
+    mCtx->reset();
+    return reparse(doc, {});
+}
+
+ParseResult* IncrementalParser::reparse(std::string* doc, const std::vector<Edit>& edits) {
+    for (const Edit& edit : edits)
+        mCtx->edit(edit);
+
+    CodeTracker trckr(doc);
+    trckr.mCtx = mCtx.get();
+    mCtx->rebase(&trckr);
+
+    ParseResult* res = mTable->parse(mRoot, &trckr);
+    trckr.mCtx = nullptr;
+
+    return res;
+}
+
+ParseContext* IncrementalParser::context() {
+    return mCtx.get();
+}
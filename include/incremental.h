@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "iguana.h"
+#include "context.h"
+
+namespace Iguana {
+    // Parses a document over and over as it is edited. Results of memoized
+    // parsers are kept between parses; after an edit, the ones that never
+    // looked at the changed bytes are reused at their new offsets, so only
+    // the parsers around the edit run again.
+    //
+    // Returned results do not own their tree: it stays valid until the next
+    // parse or reparse, and the text it points into must outlive it. Reused
+    // subtrees are shared with earlier parses and their offsets are brought
+    // up to date as they are read, so a tree must not be read from several
+    // threads at once.
+    class IncrementalParser {
+    private:
+        GlobalParserTable* mTable;
+        Parser* mRoot;
+        std::unique_ptr<ParseContext> mCtx;
+
+    public:
+        IncrementalParser(GlobalParserTable*, Parser*);
+
+        ParseResult* parse(std::string*);
+        ParseResult* reparse(std::string*, const std::vector<Edit>&);
+
+        ParseContext* context();
+    };
+}
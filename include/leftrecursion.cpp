@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+#include "leftrecursion.h"
+#include "firstset.h"
+#include "iguana.h"
+
+using namespace Iguana;
+
+static bool nullable(const FirstSet& set) {
+    return !set.mEmpty.empty() || set.mEmptyAtEof;
+}
+
+LeftRecursion::LeftRecursion(const std::vector<Parser*>& roots) {
+    FirstSets sets(roots);
+
+    for (Parser* p : roots)
+        collect(p, sets);
+
+    std::set<Parser*> all(mOrder.begin(), mOrder.end());
+
+    for (const std::vector<Parser*>& cycle : cycles(all)) {
+        std::size_t first = mLeaders.size();
+        resolve(cycle);
+
+        for (Parser* p : cycle) {
+            if (p != mLeaders[first] || mLeaders.size() - first > 1)
+                mCyclic.insert(p);
+        }
+    }
+}
+
+// Records the parsers p may call at its own start.
+void LeftRecursion::collect(Parser* p, const FirstSets& sets) {
+    if (mCalls.count(p))
+        return;
+
+    std::vector<Parser*>& calls = mCalls[p];
+    mOrder.push_back(p);
+
+    switch (p->mType) {
+        case PTypes::And:
+            for (Parser* child : p->mParsers) {
+                calls.push_back(child);
+
+                if (!nullable(sets.of(child)))
+                    break;
+            }
+            break;
+
+        case PTypes::Or:
+        case PTypes::Until:
+            calls = p->mParsers;
+            break;
+
+        case PTypes::Many:
+        case PTypes::Closure:
+        case PTypes::Number:
+        case PTypes::Range:
+        case PTypes::MoreThan:
+        case PTypes::LessThan:
+            calls.push_back(p->mParsers[0]);
+            break;
+
+        default:
+            break;
+    }
+
+    for (Parser* child : p->mParsers)
+        collect(child, sets);
+}
+
+// Strongly connected components of the calls among the given parsers
+// that contain a cycle.
+std::vector<std::vector<Parser*>> LeftRecursion::cycles(const std::set<Parser*>& within) const {
+    std::map<Parser*, int> index;
+    std::map<Parser*, int> low;
+    std::vector<Parser*> stack;
+    std::set<Parser*> onStack;
+    std::vector<std::vector<Parser*>> found;
+
+    std::function<void(Parser*)> visit = [&](Parser* p) {
+        int id = index.size();
+        index[p] = id;
+        low[p] = id;
+        stack.push_back(p);
+        onStack.insert(p);
+
+        bool selfCall = false;
+        for (Parser* q : mCalls.at(p)) {
+            if (!within.count(q))
+                continue;
+
+            if (q == p)
+                selfCall = true;
+
+            if (!index.count(q)) {
+                visit(q);
+                low[p] = std::min(low[p], low[q]);
+            } else if (onStack.count(q)) {
+                low[p] = std::min(low[p], index[q]);
+            }
+        }
+
+        if (low[p] != id)
+            return;
+
+        std::vector<Parser*> component;
+        Parser* q;
+        do {
+            q = stack.back();
+            stack.pop_back();
+            onStack.erase(q);
+            component.push_back(q);
+        } while (q != p);
+
+        if (component.size() > 1 || selfCall)
+            found.push_back(component);
+    };
+
+    for (Parser* p : mOrder) {
+        if (within.count(p) && !index.count(p))
+            visit(p);
+    }
+
+    return found;
+}
+
+// Picks a leader for the cycle, then for any cycle that remains without it.
+void LeftRecursion::resolve(const std::vector<Parser*>& cycle) {
+    std::set<Parser*> rest(cycle.begin(), cycle.end());
+    Parser* leader = nullptr;
+
+    for (Parser* p : mOrder) {
+        if (!rest.count(p))
+            continue;
+
+        if (leader == nullptr || (leader->mName.empty() && !p->mName.empty()))
+            leader = p;
+    }
+
+    mLeaders.push_back(leader);
+    rest.erase(leader);
+
+    for (const std::vector<Parser*>& inner : cycles(rest))
+        resolve(inner);
+}
+
+const std::vector<Parser*>& LeftRecursion::leaders() const {
+    return mLeaders;
+}
+
+void LeftRecursion::mark() const {
+    for (Parser* p : mOrder) {
+        p->mLeftRecursive = false;
+        p->mCyclic = mCyclic.count(p) > 0;
+    }
+
+    for (Parser* p : mLeaders)
+        p->mLeftRecursive = true;
+}
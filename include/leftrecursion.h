@@ -0,0 +1,39 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace Iguana {
+    class Parser;
+    class FirstSets;
+
+    // Finds the cycles of rules that can call each other at their own start
+    // without consuming input, which plain recursive descent would follow
+    // forever. One leader is picked per cycle, and again within what is
+    // left of it, until no cycle remains; a leader parses by growing a seed
+    // (see Parser::growSeed). Named rules are preferred as leaders so the
+    // tree keeps the grammar's names.
+    class LeftRecursion {
+    private:
+        std::map<Parser*, std::vector<Parser*>> mCalls;
+        std::vector<Parser*> mOrder;
+        std::vector<Parser*> mLeaders;
+
+        // Cycle members whose results depend on a seed they do not grow
+        // alone, so they cannot be memoized.
+        std::set<Parser*> mCyclic;
+
+        void collect(Parser*, const FirstSets&);
+        std::vector<std::vector<Parser*>> cycles(const std::set<Parser*>&) const;
+        void resolve(const std::vector<Parser*>&);
+
+    public:
+        LeftRecursion(const std::vector<Parser*>&);
+
+        const std::vector<Parser*>& leaders() const;
+
+        // Sets the flags the parse functions read on every reachable parser.
+        void mark() const;
+    };
+}
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include "lineindex.h"
+
+using namespace Iguana;
+
+LineIndex::LineIndex(const std::string* code)
+    : LineIndex(code, 0, Position{ 1, 1 })
+{}
+
+LineIndex::LineIndex(std::string_view code)
+    : mCode(nullptr), mView(code), mBegin(0), mEnd(npos), mOrigin{ 1, 1 }
+{}
+
+LineIndex::LineIndex(const std::string* code, std::size_t begin, Position origin)
+    : mCode(code), mBegin(begin), mEnd(npos), mOrigin(origin)
+{}
+
+void LineIndex::limit(std::size_t end) {
+    mEnd = end;
+}
+
+void LineIndex::build() {
+    std::string_view code = mCode != nullptr ? std::string_view(*mCode) : mView;
+    const char* begin = code.data();
+    const char* end = begin + std::min(mEnd, code.length());
+    const char* p = begin + mBegin;
+
+    while (p < end) {
+        const void* nl = std::memchr(p, '\n', end - p);
+
+        if (nl == nullptr)
+            break;
+
+        p = static_cast<const char*>(nl);
+        mNewlines.push_back(p - begin);
+        ++p;
+    }
+}
+
+LineIndex::Position LineIndex::position(std::size_t offset) {
+    std::call_once(mBuilt, &LineIndex::build, this);
+
+    auto it = std::lower_bound(mNewlines.begin(), mNewlines.end(), offset);
+    std::size_t line = it - mNewlines.begin();
+
+    if (line == 0)
+        return Position{ mOrigin.mLin, offset - mBegin + mOrigin.mCol };
+
+    return Position{ mOrigin.mLin + line, offset - mNewlines[line - 1] };
+}
+
+std::size_t LineIndex::line(std::size_t offset) {
+    return position(offset).mLin;
+}
+
+std::size_t LineIndex::col(std::size_t offset) {
+    return position(offset).mCol;
+}
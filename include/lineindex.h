@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Iguana {
+    class LineIndex {
+    public:
+        struct Position {
+            std::size_t mLin;
+            std::size_t mCol;
+        };
+
+        static const std::size_t npos = static_cast<std::size_t>(-1);
+
+    private:
+        const std::string* mCode;
+        std::string_view mView;
+        std::size_t mBegin;
+        std::size_t mEnd;
+        Position mOrigin;
+        std::vector<std::size_t> mNewlines;
+        std::once_flag mBuilt;
+
+        void build();
+
+    public:
+        LineIndex(const std::string*);
+        LineIndex(std::string_view);
+
+        // Indexes the code from offset begin on, which sits at the given
+        // position of a larger input.
+        LineIndex(const std::string*, std::size_t, Position);
+
+        // Stops the index at offset end; must be called before the first
+        // lookup.
+        void limit(std::size_t);
+
+        Position position(std::size_t);
+        std::size_t line(std::size_t);
+        std::size_t col(std::size_t);
+    };
+}
@@ -0,0 +1,68 @@
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mappedfile.h"
+
+using namespace Iguana;
+
+MappedFile::MappedFile(const std::string& path)
+    : mData(""), mSize(0), mMapped(false)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        mError = "Could not open " + path + ": " + std::strerror(errno);
+        return;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        mError = "Could not stat " + path + ": " + std::strerror(errno);
+        ::close(fd);
+        return;
+    }
+
+    // An empty file cannot be mapped and reads as empty input.
+    if (st.st_size > 0) {
+        void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (addr == MAP_FAILED) {
+            mError = "Could not map " + path + ": " + std::strerror(errno);
+            ::close(fd);
+            return;
+        }
+
+        ::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+        mData = static_cast<const char*>(addr);
+        mSize = st.st_size;
+        mMapped = true;
+    }
+
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (mMapped)
+        ::munmap(const_cast<char*>(mData), mSize);
+}
+
+bool MappedFile::valid() const {
+    return mError.empty();
+}
+
+const std::string& MappedFile::error() const {
+    return mError;
+}
+
+std::string_view MappedFile::view() const {
+    return std::string_view(mData, mSize);
+}
+
+std::size_t MappedFile::size() const {
+    return mSize;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace Iguana {
+    // A file mapped read-only into memory. Parsing reads straight from the
+    // mapping, so nothing is copied and the file's size is the only limit.
+    class MappedFile {
+    private:
+        const char* mData;
+        std::size_t mSize;
+        bool mMapped;
+        std::string mError;
+
+    public:
+        MappedFile(const std::string&);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        bool valid() const;
+        const std::string& error() const;
+        std::string_view view() const;
+        std::size_t size() const;
+    };
+}
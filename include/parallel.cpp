@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "codetracker.h"
+#include "iguana.h"
+#include "context.h"
+#include "arena.h"
+#include "scan.h"
+#include "workerpool.h"
+
+using namespace Iguana;
+
+// Below this many bytes per chunk the threads cost more than they save.
+static const std::size_t MIN_CHUNK = 64 * 1024;
+
+// More chunks than threads, so a thread that drew short or simple chunks
+// picks up more instead of idling.
+static const unsigned int CHUNKS_PER_THREAD = 4;
+
+namespace {
+    struct Chunk {
+        std::size_t mBegin;
+        std::size_t mEnd;
+        std::unique_ptr<ParseContext> mCtx;
+        std::pmr::vector<Node>* mNodes;
+        std::size_t mStop;
+        std::size_t mReach;
+        bool mFailed;
+        std::exception_ptr mError;
+    };
+}
+
+// Returns nullptr when the input is too short to be worth splitting or
+// no pool threads are free.
+RuleResult* Parser::parseManyParallel(CodeTracker* trckr) {
+    ParseContext* ctx = trckr->mCtx;
+    std::string_view input = trckr->input();
+    const std::size_t npos = std::string_view::npos;
+
+    trckr->skipWhitespace();
+    std::size_t start = trckr->mIdx;
+
+    WorkerPool* pool = ctx->mPool != nullptr ? ctx->mPool : WorkerPool::shared();
+    std::size_t threads = mThreads != 0 ? std::min<std::size_t>(mThreads, pool->threads()) : pool->threads();
+    std::size_t count = std::min<std::size_t>(threads * CHUNKS_PER_THREAD, (input.length() - start) / MIN_CHUNK);
+
+    if (threads < 2 || count < 2)
+        return nullptr;
+
+    // Cut just after the first sync at or past each even split point.
+    std::vector<Chunk> chunks(1);
+    chunks[0].mBegin = start;
+
+    for (std::size_t k = 1; k < count; k++) {
+        std::size_t at = std::max(start + (input.length() - start) * k / count, chunks.back().mBegin + 1);
+        std::size_t sync = input.find(mSync, at);
+
+        if (sync == npos || sync + mSync.length() >= input.length())
+            break;
+
+        chunks.emplace_back();
+        chunks.back().mBegin = sync + mSync.length();
+    }
+
+    // Items are parsed until one fails or the next would start at or past
+    // to. Returns whether one failed.
+    Parser* p = mParsers[0];
+    auto parseItems = [p, input](CodeTracker* t, std::pmr::vector<Node>& nodes, std::size_t to) {
+        while (true) {
+            std::size_t next = t->mIdx + scanWhitespace(input.data() + t->mIdx, input.data() + input.length());
+            if (to != npos && next >= to)
+                return false;
+
+            CodeTracker::Checkpoint cp = t->save();
+            RuleResult* pres = p->parse(t);
+
+            if (pres->mError) {
+                t->restore(cp);
+                return true;
+            }
+
+            nodes.push_back(*pres->mNode);
+        }
+    };
+
+    for (std::size_t k = 0; k < chunks.size(); k++)
+        chunks[k].mEnd = k + 1 < chunks.size() ? chunks[k + 1].mBegin : npos;
+
+    auto work = [&](std::size_t, std::size_t k) {
+        Chunk& c = chunks[k];
+
+        try {
+            c.mCtx.reset(new ParseContext());
+            c.mCtx->mSerial = true;
+
+            CodeTracker t(input);
+            t.mLines = trckr->mLines;
+            t.mCtx = c.mCtx.get();
+            t.mIdx = c.mBegin;
+
+            c.mNodes = c.mCtx->make<std::pmr::vector<Node>>();
+            c.mFailed = parseItems(&t, *c.mNodes, c.mEnd);
+            c.mStop = t.mIdx;
+            c.mReach = t.mReach;
+        } catch (...) {
+            c.mError = std::current_exception();
+        }
+    };
+
+    // A pool busy with another parse, or with the one this is nested in,
+    // leaves the repetition to the serial parser.
+    if (!pool->tryRun(chunks.size(), work, threads))
+        return nullptr;
+
+    for (Chunk& c : chunks) {
+        if (c.mError)
+            std::rethrow_exception(c.mError);
+    }
+
+    // Join the chunks in order. A chunk is taken as parsed when the items
+    // before it end where it begins; otherwise its cut fell inside an item
+    // and the serial parse carries on from there to the next cut.
+    auto skip = [input](std::size_t pos) {
+        return pos + scanWhitespace(input.data() + pos, input.data() + input.length());
+    };
+
+    std::pmr::vector<Node> nodes(ctx->arena());
+    std::size_t pos = start;
+    bool failed = false;
+
+    for (std::size_t k = 0; k < chunks.size() && !failed; k++) {
+        Chunk& c = chunks[k];
+
+        if (skip(pos) == skip(c.mBegin)) {
+            ctx->arena()->adopt(c.mCtx->release());
+
+            for (Node& node : *c.mNodes)
+                nodes.push_back(std::move(node));
+
+            for (const Parser* e : c.mCtx->mExpected)
+                ctx->expect(e, c.mCtx->mFailPos);
+
+            trckr->touch(c.mReach);
+            pos = c.mStop;
+            failed = c.mFailed;
+            continue;
+        }
+
+        trckr->restore(CodeTracker::Checkpoint{ pos });
+        failed = parseItems(trckr, nodes, c.mEnd);
+        pos = trckr->mIdx;
+    }
+
+    trckr->restore(CodeTracker::Checkpoint{ pos });
+
+    RuleResult* res = ctx->make<RuleResult>();
+    if (nodes.size() == 0)
+        return res->failure("");
+
+    Node* resNode = makeNode(trckr, start);
+    resNode->setNodes(std::move(nodes));
+
+    return res->success(resNode);
+}
@@ -0,0 +1,296 @@
+#include <cstring>
+#include <string_view>
+#include "scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IGUANA_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace Iguana;
+
+ByteSet::ByteSet() {
+    std::memset(mTable, 0, sizeof(mTable));
+}
+
+ByteSet::ByteSet(std::string_view members)
+    : ByteSet()
+{
+    for (char ch : members)
+        set(static_cast<unsigned char>(ch));
+}
+
+void ByteSet::set(unsigned char b) {
+    mTable[(b & 0x0F) + (b & 0x80 ? 16 : 0)] |= 1 << ((b >> 4) & 7);
+}
+
+void ByteSet::setRange(unsigned char lo, unsigned char hi) {
+    for (int b = lo; b <= hi; ++b)
+        set(static_cast<unsigned char>(b));
+}
+
+void ByteSet::merge(const ByteSet& other) {
+    for (int i = 0; i < 32; ++i)
+        mTable[i] |= other.mTable[i];
+}
+
+void ByteSet::intersect(const ByteSet& other) {
+    for (int i = 0; i < 32; ++i)
+        mTable[i] &= other.mTable[i];
+}
+
+void ByteSet::invert() {
+    for (int i = 0; i < 32; ++i)
+        mTable[i] = ~mTable[i];
+}
+
+bool ByteSet::test(unsigned char b) const {
+    return (mTable[(b & 0x0F) + (b & 0x80 ? 16 : 0)] >> ((b >> 4) & 7)) & 1;
+}
+
+bool ByteSet::empty() const {
+    for (int i = 0; i < 32; ++i)
+        if (mTable[i] != 0)
+            return false;
+
+    return true;
+}
+
+bool ByteSet::operator==(const ByteSet& other) const {
+    return std::memcmp(mTable, other.mTable, sizeof(mTable)) == 0;
+}
+
+namespace {
+    enum Kind {
+        Space,
+        NonSpace,
+        Digit,
+        Alpha,
+        Alnum,
+        Set,
+        KindCount
+    };
+
+    struct Builtins {
+        ByteSet mSets[KindCount];
+
+        Builtins() {
+            mSets[Space] = ByteSet(" \t\n\v\f\r");
+            mSets[NonSpace] = mSets[Space];
+            mSets[NonSpace].invert();
+            mSets[Digit].setRange('0', '9');
+            mSets[Alpha].setRange('a', 'z');
+            mSets[Alpha].setRange('A', 'Z');
+            mSets[Alnum] = mSets[Alpha];
+            mSets[Alnum].merge(mSets[Digit]);
+        }
+    };
+
+    const ByteSet& builtin(int kind, const ByteSet* set) {
+        static const Builtins builtins;
+        return kind == Set ? *set : builtins.mSets[kind];
+    }
+
+    typedef std::size_t (*Kernel)(const char*, const char*, const ByteSet*);
+
+    template <int K>
+    std::size_t runScalar(const char* begin, const char* end, const ByteSet* set) {
+        const ByteSet& cls = builtin(K, set);
+        const char* p = begin;
+
+        while (p < end && cls.test(static_cast<unsigned char>(*p)))
+            ++p;
+
+        return p - begin;
+    }
+
+#ifdef IGUANA_SCAN_X86
+    // Bytes in [lo, lo + span] map to 0xFF. Unsigned compare through min.
+    __attribute__((target("ssse3")))
+    inline __m128i inRange128(__m128i v, char lo, char span) {
+        __m128i x = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+        return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(span)), x);
+    }
+
+    __attribute__((target("ssse3")))
+    inline __m128i classify128(__m128i v, __m128i lo, __m128i hi, __m128i bits) {
+        __m128i nib = _mm_set1_epi8(0x0F);
+        __m128i low = _mm_and_si128(v, nib);
+        __m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), nib);
+        __m128i upper = _mm_cmpgt_epi8(high, _mm_set1_epi8(7));
+        __m128i row = _mm_or_si128(
+            _mm_andnot_si128(upper, _mm_shuffle_epi8(lo, low)),
+            _mm_and_si128(upper, _mm_shuffle_epi8(hi, low)));
+        __m128i bit = _mm_shuffle_epi8(bits, high);
+        return _mm_cmpeq_epi8(_mm_and_si128(row, bit), bit);
+    }
+
+    template <int K>
+    __attribute__((target("ssse3")))
+    std::size_t runSsse3(const char* begin, const char* end, const ByteSet* set) {
+        const ByteSet& cls = builtin(K, set);
+        __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(cls.mTable));
+        __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(cls.mTable + 16));
+        __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+                                     1, 2, 4, 8, 16, 32, 64, -128);
+        const char* p = begin;
+
+        while (end - p >= 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i m;
+
+            if (K == Space || K == NonSpace)
+                m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), inRange128(v, '\t', 4));
+            else if (K == Digit)
+                m = inRange128(v, '0', 9);
+            else if (K == Alpha)
+                m = inRange128(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 25);
+            else if (K == Alnum)
+                m = _mm_or_si128(inRange128(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 25),
+                                 inRange128(v, '0', 9));
+            else
+                m = classify128(v, lo, hi, bits);
+
+            unsigned int miss = _mm_movemask_epi8(m);
+            miss = K == NonSpace ? miss : ~miss & 0xFFFF;
+
+            if (miss != 0)
+                return p - begin + __builtin_ctz(miss);
+
+            p += 16;
+        }
+
+        return p - begin + runScalar<K>(p, end, set);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i inRange256(__m256i v, char lo, char span) {
+        __m256i x = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(span)), x);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i classify256(__m256i v, __m256i lo, __m256i hi, __m256i bits) {
+        __m256i nib = _mm256_set1_epi8(0x0F);
+        __m256i low = _mm256_and_si256(v, nib);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), nib);
+        __m256i upper = _mm256_cmpgt_epi8(high, _mm256_set1_epi8(7));
+        __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(lo, low),
+                                         _mm256_shuffle_epi8(hi, low), upper);
+        __m256i bit = _mm256_shuffle_epi8(bits, high);
+        return _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+    }
+
+    template <int K>
+    __attribute__((target("avx2")))
+    std::size_t runAvx2(const char* begin, const char* end, const ByteSet* set) {
+        const ByteSet& cls = builtin(K, set);
+        __m256i lo = _mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(cls.mTable)));
+        __m256i hi = _mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(cls.mTable + 16)));
+        __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+                                        1, 2, 4, 8, 16, 32, 64, -128,
+                                        1, 2, 4, 8, 16, 32, 64, -128,
+                                        1, 2, 4, 8, 16, 32, 64, -128);
+        const char* p = begin;
+
+        while (end - p >= 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i m;
+
+            if (K == Space || K == NonSpace)
+                m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), inRange256(v, '\t', 4));
+            else if (K == Digit)
+                m = inRange256(v, '0', 9);
+            else if (K == Alpha)
+                m = inRange256(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 25);
+            else if (K == Alnum)
+                m = _mm256_or_si256(inRange256(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 25),
+                                    inRange256(v, '0', 9));
+            else
+                m = classify256(v, lo, hi, bits);
+
+            unsigned int miss = _mm256_movemask_epi8(m);
+            miss = K == NonSpace ? miss : ~miss;
+
+            if (miss != 0)
+                return p - begin + __builtin_ctz(miss);
+
+            p += 32;
+        }
+
+        return p - begin + runSsse3<K>(p, end, set);
+    }
+#endif
+
+    struct Kernels {
+        Kernel mRun[KindCount];
+        const char* mName;
+
+        Kernels() {
+            mRun[Space] = runScalar<Space>;
+            mRun[NonSpace] = runScalar<NonSpace>;
+            mRun[Digit] = runScalar<Digit>;
+            mRun[Alpha] = runScalar<Alpha>;
+            mRun[Alnum] = runScalar<Alnum>;
+            mRun[Set] = runScalar<Set>;
+            mName = "scalar";
+
+#ifdef IGUANA_SCAN_X86
+            __builtin_cpu_init();
+
+            if (__builtin_cpu_supports("avx2")) {
+                mRun[Space] = runAvx2<Space>;
+                mRun[NonSpace] = runAvx2<NonSpace>;
+                mRun[Digit] = runAvx2<Digit>;
+                mRun[Alpha] = runAvx2<Alpha>;
+                mRun[Alnum] = runAvx2<Alnum>;
+                mRun[Set] = runAvx2<Set>;
+                mName = "avx2";
+            } else if (__builtin_cpu_supports("ssse3")) {
+                mRun[Space] = runSsse3<Space>;
+                mRun[NonSpace] = runSsse3<NonSpace>;
+                mRun[Digit] = runSsse3<Digit>;
+                mRun[Alpha] = runSsse3<Alpha>;
+                mRun[Alnum] = runSsse3<Alnum>;
+                mRun[Set] = runSsse3<Set>;
+                mName = "ssse3";
+            }
+#endif
+        }
+    };
+
+    const Kernels& kernels() {
+        static const Kernels k;
+        return k;
+    }
+}
+
+std::size_t Iguana::scanWhitespace(const char* begin, const char* end) {
+    return kernels().mRun[Space](begin, end, nullptr);
+}
+
+std::size_t Iguana::scanNonWhitespace(const char* begin, const char* end) {
+    return kernels().mRun[NonSpace](begin, end, nullptr);
+}
+
+std::size_t Iguana::scanDigit(const char* begin, const char* end) {
+    return kernels().mRun[Digit](begin, end, nullptr);
+}
+
+std::size_t Iguana::scanAlpha(const char* begin, const char* end) {
+    return kernels().mRun[Alpha](begin, end, nullptr);
+}
+
+std::size_t Iguana::scanAlnum(const char* begin, const char* end) {
+    return kernels().mRun[Alnum](begin, end, nullptr);
+}
+
+std::size_t Iguana::scanSet(const char* begin, const char* end, const ByteSet& set) {
+    return kernels().mRun[Set](begin, end, &set);
+}
+
+const char* Iguana::scanKernelName() {
+    return kernels().mName;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace Iguana {
+    // 256-bit byte membership set laid out as two 16-entry nibble tables so
+    // that the SIMD scanners can test 16/32 bytes per step with pshufb.
+    // Byte b lives in mTable[(b & 0x0F) + (b & 0x80 ? 16 : 0)] at bit
+    // ((b >> 4) & 7).
+    class ByteSet {
+    public:
+        alignas(16) unsigned char mTable[32];
+
+        ByteSet();
+        ByteSet(std::string_view);
+
+        void set(unsigned char);
+        void setRange(unsigned char, unsigned char);
+        void merge(const ByteSet&);
+        void intersect(const ByteSet&);
+        void invert();
+        bool test(unsigned char) const;
+        bool empty() const;
+        bool operator==(const ByteSet&) const;
+    };
+
+    // Each scanner returns the length of the longest prefix of [begin, end)
+    // whose bytes all belong to the class. Classes use the "C" locale.
+    std::size_t scanWhitespace(const char*, const char*);
+    std::size_t scanNonWhitespace(const char*, const char*);
+    std::size_t scanDigit(const char*, const char*);
+    std::size_t scanAlpha(const char*, const char*);
+    std::size_t scanAlnum(const char*, const char*);
+    std::size_t scanSet(const char*, const char*, const ByteSet&);
+
+    // Name of the kernel set picked for this CPU ("avx2", "ssse3", "scalar").
+    const char* scanKernelName();
+}
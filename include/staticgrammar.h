@@ -0,0 +1,505 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "iguana.h"
+#include "codetracker.h"
+#include "context.h"
+#include "arena.h"
+#include "charclass.h"
+#include "compiledregex.h"
+#include "lineindex.h"
+#include "scan.h"
+
+// Header-only grammar front-end where the grammar is a type. Each combinator
+// mirrors its Parser counterpart and builds the same Node tree, but every
+// parse function is a static template the compiler can inline across rules.
+//
+// Names and literals are passed as pointers to constexpr char arrays:
+//
+//     static constexpr char num[] = "num", plus[] = "plus", sym[] = "+";
+//     struct Expr;
+//     using Sum = And<sum, Digit<num>, Hide<String<plus, sym>>, Expr>;
+//     struct Expr : Or<expr, Sum, Digit<num>> {};
+//
+//     ParseResult* res = Static::parse<Expr>(&trckr);
+//
+// Recursive rules are declared as structs deriving from a combinator.
+// Hide<P> drops P's node from an enclosing And, like a false include flag.
+namespace Iguana {
+    namespace Static {
+        using Nodes = std::pmr::vector<Node>;
+
+        using Describe = std::string (*)();
+
+        struct State {
+            const char* mData;
+            std::size_t mLen;
+            std::size_t mPos;
+            LineIndex* mLines;
+
+            // Farthest failure, kept the way ParseContext keeps it.
+            std::size_t mFailPos;
+            std::vector<Describe> mExpected;
+
+            void skip() {
+                mPos += scanWhitespace(mData + mPos, mData + mLen);
+            }
+
+            FailureMark mark() const {
+                return FailureMark{ mFailPos, mExpected.size() };
+            }
+
+            bool failedSince(FailureMark m, std::size_t pos) const {
+                return mFailPos == pos && mExpected.size() > (m.mPos == pos ? m.mCount : 0);
+            }
+
+            bool expect(Describe d, std::size_t pos) {
+                if (pos < mFailPos)
+                    return false;
+
+                if (pos > mFailPos) {
+                    mFailPos = pos;
+                    mExpected.clear();
+                }
+
+                for (Describe e : mExpected) {
+                    if (e == d)
+                        return false;
+                }
+
+                mExpected.push_back(d);
+                return false;
+            }
+
+            void expect(Describe d, std::size_t pos, FailureMark m) {
+                if (pos == mFailPos)
+                    mExpected.resize(m.mPos == pos ? m.mCount : 0);
+
+                expect(d, pos);
+            }
+        };
+
+        inline Node& open(State& s, Nodes& out, const char* name, std::size_t start) {
+            Node& n = out.emplace_back(name);
+            n.mLines = s.mLines;
+            n.mStart = start;
+            n.mEnd = start;
+            return n;
+        }
+
+        inline void leaf(State& s, Nodes& out, const char* name, std::size_t start, std::size_t end, bool value) {
+            Node& n = open(s, out, name, start);
+            n.mEnd = end;
+            if (value)
+                n.setValue(std::string_view(s.mData + start, end - start));
+        }
+
+        template <typename P>
+        struct Hide {
+            static constexpr const char* name = P::name;
+
+            static std::string describe() {
+                return P::describe();
+            }
+
+            static bool match(State& s, Nodes& out) {
+                if (!P::match(s, out))
+                    return false;
+
+                out.pop_back();
+                return true;
+            }
+        };
+
+        template <const char* Name, const char* Lit>
+        struct String {
+            static constexpr const char* name = Name;
+
+            static std::string describe() {
+                return std::string("'") + Lit + "'";
+            }
+
+            static bool match(State& s, Nodes& out) {
+                constexpr std::size_t len = std::char_traits<char>::length(Lit);
+
+                s.skip();
+                if (s.mLen - s.mPos < len || std::memcmp(s.mData + s.mPos, Lit, len) != 0)
+                    return s.expect(&describe, s.mPos);
+
+                leaf(s, out, Name, s.mPos, s.mPos + len, true);
+                s.mPos += len;
+                return true;
+            }
+        };
+
+        inline constexpr char alphabeticText[] = "alphabetic character";
+        inline constexpr char alphanumericText[] = "alphanumeric character";
+        inline constexpr char digitText[] = "digit";
+
+        template <const char* Name, std::size_t (*Scan)(const char*, const char*), const char* Text>
+        struct Scanned {
+            static constexpr const char* name = Name;
+
+            static std::string describe() {
+                return Text;
+            }
+
+            static bool match(State& s, Nodes& out) {
+                s.skip();
+                std::size_t len = Scan(s.mData + s.mPos, s.mData + s.mLen);
+
+                if (len == 0)
+                    return s.expect(&describe, s.mPos);
+
+                leaf(s, out, Name, s.mPos, s.mPos + len, true);
+                s.mPos += len;
+                return true;
+            }
+        };
+
+        template <const char* Name>
+        struct Alphabetic : Scanned<Name, scanAlpha, alphabeticText> {};
+
+        template <const char* Name>
+        struct Alphanumeric : Scanned<Name, scanAlnum, alphanumericText> {};
+
+        template <const char* Name>
+        struct Digit : Scanned<Name, scanDigit, digitText> {};
+
+        template <const char* Name, const char* Spec, bool Literal>
+        struct ClassBase {
+            static constexpr const char* name = Name;
+
+            static const CharClass& charClass() {
+                static const CharClass cls = Literal ? CharClass::members(Spec) : CharClass(Spec);
+                if (!cls.valid())
+                    throw "Invalid character class";
+                return cls;
+            }
+
+            static std::string describe() {
+                return std::string(Literal ? "one of " : "character in ") + Spec;
+            }
+
+            static bool match(State& s, Nodes& out) {
+                s.skip();
+                std::size_t len = charClass().scan(s.mData + s.mPos, s.mData + s.mLen);
+
+                if (len == 0)
+                    return s.expect(&describe, s.mPos);
+
+                leaf(s, out, Name, s.mPos, s.mPos + len, true);
+                s.mPos += len;
+                return true;
+            }
+        };
+
+        template <const char* Name, const char* Symbols>
+        struct Custom : ClassBase<Name, Symbols, true> {};
+
+        template <const char* Name, const char* Spec>
+        struct Class : ClassBase<Name, Spec, false> {};
+
+        template <const char* Name, const char* Pattern>
+        struct Regex {
+            static constexpr const char* name = Name;
+
+            static std::string describe() {
+                return Name;
+            }
+
+            static bool match(State& s, Nodes& out) {
+                static const CompiledRegex regx(Pattern);
+
+                s.skip();
+                if (s.mPos >= s.mLen)
+                    return s.expect(&describe, s.mPos);
+
+                std::size_t len = regx.match(s.mData + s.mPos, s.mData + s.mLen);
+                if (len == CompiledRegex::npos || len == 0)
+                    return s.expect(&describe, s.mPos);
+
+                leaf(s, out, Name, s.mPos, s.mPos + len, true);
+                s.mPos += len;
+                return true;
+            }
+        };
+
+        template <const char* Name>
+        struct EndOfFile {
+            static constexpr const char* name = Name;
+
+            static std::string describe() {
+                return "end of file";
+            }
+
+            static bool match(State& s, Nodes& out) {
+                s.skip();
+                if (s.mPos < s.mLen)
+                    return s.expect(&describe, s.mPos);
+
+                leaf(s, out, Name, s.mPos, s.mPos, false);
+                return true;
+            }
+        };
+
+        template <const char* Name, typename... Ps>
+        struct And {
+            static constexpr const char* name = Name;
+
+            static std::string describe() {
+                return Name;
+            }
+
+            static bool match(State& s, Nodes& out) {
+                s.skip();
+                Node& n = open(s, out, Name, s.mPos);
+                Nodes children(out.get_allocator());
+                children.reserve(sizeof...(Ps));
+
+                if (!(Ps::match(s, children) && ...)) {
+                    out.pop_back();
+                    return false;
+                }
+
+                n.setNodes(std::move(children));
+                n.mEnd = s.mPos;
+                return true;
+            }
+        };
+
+        template <const char* Name, typename P, typename... Ps>
+        struct Or {
+            static constexpr const char* name = Name;
+
+            static std::string describe() {
+                std::string expected = std::string("one of '") + P::name + "'";
+                ((expected += std::string(", '") + Ps::name + "'"), ...);
+                return expected;
+            }
+
+            template <typename C>
+            static bool attempt(State& s, Nodes& nodes, std::size_t start) {
+                if (C::match(s, nodes))
+                    return true;
+
+                s.mPos = start;
+                return false;
+            }
+
+            static bool match(State& s, Nodes& out) {
+                FailureMark mark = s.mark();
+                s.skip();
+                std::size_t start = s.mPos;
+                Node& n = open(s, out, Name, start);
+                Nodes children(out.get_allocator());
+                children.reserve(1);
+
+                bool matched = (attempt<P>(s, children, start) || ... || attempt<Ps>(s, children, start));
+
+                if (s.failedSince(mark, start))
+                    s.expect(&describe, start, mark);
+
+                if (!matched) {
+                    out.pop_back();
+                    return false;
+                }
+
+                n.mEnd = s.mPos;
+
+                if (children[0].mName.empty()) {
+                    Node child(std::move(children[0]), out.get_allocator());
+                    child.mName = Name;
+                    n = std::move(child);
+                } else {
+                    n.setNodes(std::move(children));
+                }
+                return true;
+            }
+        };
+
+        // Matches P as many times as it succeeds, up to Max, into nodes.
+        template <typename P>
+        unsigned int repeat(State& s, Nodes& nodes, unsigned int max) {
+            unsigned int count = 0;
+
+            while (count < max) {
+                std::size_t cp = s.mPos;
+
+                if (!P::match(s, nodes)) {
+                    s.mPos = cp;
+                    break;
+                }
+
+                ++count;
+            }
+
+            return count;
+        }
+
+        template <const char* Name, typename P, unsigned int Min, unsigned int Max>
+        struct Repeat {
+            static constexpr const char* name = Name;
+
+            static bool match(State& s, Nodes& out) {
+                s.skip();
+                Node& n = open(s, out, Name, s.mPos);
+                Nodes children(out.get_allocator());
+
+                if (repeat<P>(s, children, Max) < Min) {
+                    out.pop_back();
+                    return false;
+                }
+
+                n.setNodes(std::move(children));
+                n.mEnd = s.mPos;
+                return true;
+            }
+        };
+
+        template <const char* Name, typename P>
+        struct Many : Repeat<Name, P, 1, ~0u> {
+            static std::string describe() {
+                return std::string("one or more of '") + Name + "'";
+            }
+        };
+
+        template <const char* Name, typename P>
+        struct Closure {
+            static constexpr const char* name = Name;
+
+            static std::string describe() {
+                return Name;
+            }
+
+            static bool match(State& s, Nodes& out) {
+                s.skip();
+                Node& n = open(s, out, Name, s.mPos);
+                Nodes children(out.get_allocator());
+
+                if (Many<Name, P>::match(s, children))
+                    n.setNodes(std::move(children));
+
+                n.mEnd = s.mPos;
+                return true;
+            }
+        };
+
+        template <const char* Name, typename P, unsigned int N>
+        struct Number : Repeat<Name, P, N, N> {
+            static std::string describe() {
+                return std::to_string(N) + " of " + Name;
+            }
+        };
+
+        template <const char* Name, typename P, unsigned int L, unsigned int H>
+        struct Range : Repeat<Name, P, L, H> {
+            static std::string describe() {
+                return std::to_string(L) + "-" + std::to_string(H) + " of " + Name;
+            }
+        };
+
+        template <const char* Name, typename P, unsigned int L>
+        struct MoreThan : Repeat<Name, P, L + 1, ~0u> {
+            static std::string describe() {
+                return "More than " + std::to_string(L) + " of " + Name;
+            }
+        };
+
+        template <const char* Name, typename P, unsigned int H>
+        struct LessThan : Repeat<Name, P, 1, (H > 0 ? H - 1 : 0)> {
+            static std::string describe() {
+                return "less than " + std::to_string(H) + " of " + Name;
+            }
+        };
+
+        template <const char* Name, typename P, typename U>
+        struct Until {
+            static constexpr const char* name = Name;
+
+            static std::string describe() {
+                return P::name;
+            }
+
+            static bool match(State& s, Nodes& out) {
+                s.skip();
+                Node& n = open(s, out, Name, s.mPos);
+                Nodes children(out.get_allocator());
+
+                while (true) {
+                    std::size_t cp = s.mPos;
+                    bool done = Hide<U>::match(s, children);
+                    s.mPos = cp;
+
+                    if (done)
+                        break;
+
+                    if (!Hide<P>::match(s, children)) {
+                        out.pop_back();
+                        return false;
+                    }
+                }
+
+                n.mEnd = s.mPos;
+                return true;
+            }
+        };
+
+        // Parses with grammar G the way GlobalParserTable::parse does,
+        // reporting the farthest failure in the same message format.
+        template <typename G>
+        ParseResult* parse(CodeTracker* trckr) {
+            ParseContext localCtx;
+            ParseContext* ctx = trckr->mCtx;
+            if (ctx == nullptr) {
+                ctx = &localCtx;
+                trckr->mCtx = ctx;
+            }
+
+            std::string_view input = trckr->input();
+            State s{ input.data(), input.length(), trckr->mIdx, trckr->mLines.get(), 0, {} };
+            Nodes* top = ctx->make<Nodes>();
+
+            ParseResult* res = new ParseResult();
+
+            if (G::match(s, *top)) {
+                trckr->mIdx = s.mPos;
+                res->success(&(*top)[0]);
+            } else {
+                std::size_t pos = s.mFailPos;
+                std::string expected;
+
+                if (s.mExpected.empty()) {
+                    pos = trckr->mIdx + scanWhitespace(s.mData + trckr->mIdx, s.mData + s.mLen);
+                    expected = G::describe();
+                }
+
+                for (std::size_t i = 0; i < s.mExpected.size(); ++i)
+                    expected += (i == 0 ? "" : " or ") + s.mExpected[i]();
+
+                LineIndex::Position lc = s.mLines->position(pos);
+
+                std::ostringstream err;
+                err << G::name << " Parsing Error: Expected " << expected
+                    << " (" << lc.mLin << ":" << lc.mCol << ")";
+
+                trckr->mIdx = s.mPos;
+                res->failure(err.str());
+            }
+
+            res->mArena = ctx->release();
+            res->mLines = trckr->mLines;
+
+            if (ctx == &localCtx)
+                trckr->mCtx = nullptr;
+
+            return res;
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include "stream.h"
+#include "lineindex.h"
+
+using namespace Iguana;
+
+StreamSource::StreamSource(std::istream& stream, std::size_t chunk)
+    : mStream(&stream), mFd(-1), mStart(0), mBase(0), mChunk(chunk),
+    mPeak(0), mExhausted(false), mOrigin{ 1, 1 }
+{}
+
+StreamSource::StreamSource(int fd, std::size_t chunk)
+    : mStream(nullptr), mFd(fd), mStart(0), mBase(0), mChunk(chunk),
+    mPeak(0), mExhausted(false), mOrigin{ 1, 1 }
+{}
+
+std::size_t StreamSource::read(char* buf, std::size_t n) {
+    if (mStream != nullptr) {
+        mStream->read(buf, n);
+        return mStream->gcount();
+    }
+
+    while (true) {
+        ssize_t got = ::read(mFd, buf, n);
+
+        if (got >= 0)
+            return got;
+
+        if (errno != EINTR)
+            throw "Failed to read input stream";
+    }
+}
+
+bool StreamSource::fill(std::size_t n) {
+    if (mExhausted)
+        return false;
+
+    // Read aside first so the window, which results may still point into,
+    // is left alone when nothing arrives.
+    std::unique_ptr<char[]> buf(new char[n]);
+    std::size_t got = read(buf.get(), n);
+
+    if (got == 0)
+        mExhausted = true;
+    else
+        mWindow.append(buf.get(), got);
+
+    mPeak = std::max(mPeak, mWindow.size());
+    return got > 0;
+}
+
+void StreamSource::discard(std::size_t n) {
+    const char* begin = mWindow.data() + mStart;
+    const char* end = begin + n;
+
+    for (const char* p = begin; p < end; ++p) {
+        const void* nl = std::memchr(p, '\n', end - p);
+
+        if (nl == nullptr) {
+            mOrigin.mCol += end - p;
+            break;
+        }
+
+        p = static_cast<const char*>(nl);
+        mOrigin.mLin++;
+        mOrigin.mCol = 1;
+    }
+
+    mStart += n;
+
+    // Dropped bytes are only moved out once they make up half the window,
+    // so each byte is copied at most once on average.
+    if (mStart * 2 >= mWindow.size()) {
+        mWindow.erase(0, mStart);
+        mBase += mStart;
+        mStart = 0;
+    }
+}
+
+std::string* StreamSource::window() {
+    return &mWindow;
+}
+
+std::size_t StreamSource::start() const {
+    return mStart;
+}
+
+std::size_t StreamSource::base() const {
+    return mBase;
+}
+
+std::size_t StreamSource::chunk() const {
+    return mChunk;
+}
+
+std::size_t StreamSource::peak() const {
+    return mPeak;
+}
+
+bool StreamSource::exhausted() const {
+    return mExhausted;
+}
+
+std::shared_ptr<LineIndex> StreamSource::lines() {
+    return std::make_shared<LineIndex>(&mWindow, mStart, mOrigin);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+#include "lineindex.h"
+
+namespace Iguana {
+    // Input pulled in chunks from a std::istream or a file descriptor. Only
+    // a window of the input is held: bytes are appended as parsers ask for
+    // more and dropped once no backtrack point can return to them, so
+    // memory follows the largest item rather than the whole input.
+    class StreamSource {
+    private:
+        std::istream* mStream;
+        int mFd;
+        std::string mWindow;
+        std::size_t mStart;
+        std::size_t mBase;
+        std::size_t mChunk;
+        std::size_t mPeak;
+        bool mExhausted;
+        LineIndex::Position mOrigin;
+
+        std::size_t read(char*, std::size_t);
+
+    public:
+        static const std::size_t DEFAULT_CHUNK = 64 * 1024;
+
+        StreamSource(std::istream&, std::size_t = DEFAULT_CHUNK);
+        StreamSource(int, std::size_t = DEFAULT_CHUNK);
+
+        // Appends up to n more bytes to the window. Returns false once the
+        // input is exhausted and nothing was added.
+        bool fill(std::size_t);
+
+        // Drops the first n live bytes of the window.
+        void discard(std::size_t);
+
+        // Parsing happens on the window directly; live bytes start at
+        // start(), which is input offset base() + start().
+        std::string* window();
+        std::size_t start() const;
+        std::size_t base() const;
+        std::size_t chunk() const;
+        std::size_t peak() const;
+        bool exhausted() const;
+
+        // Line index over the live bytes, positioned within the whole input.
+        std::shared_ptr<LineIndex> lines();
+    };
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <string>
+#include <vector>
+#include "trie.h"
+
+using namespace Iguana;
+
+LiteralTrie::LiteralTrie(const std::vector<std::string>& literals) {
+    std::vector<std::map<unsigned char, int>> children(1);
+    std::vector<int> accept(1, -1);
+
+    for (std::size_t idx = 0; idx < literals.size(); idx++) {
+        std::size_t node = 0;
+
+        for (char ch : literals[idx]) {
+            unsigned char b = static_cast<unsigned char>(ch);
+            auto it = children[node].find(b);
+
+            if (it != children[node].end()) {
+                node = it->second;
+                continue;
+            }
+
+            // Index the new child before growing the vector, which may move
+            // the map the lookup ran on.
+            std::size_t child = children.size();
+            children[node].emplace(b, child);
+            children.emplace_back();
+            accept.push_back(-1);
+            node = child;
+        }
+
+        if (accept[node] < 0)
+            accept[node] = idx;
+    }
+
+    mNodes.resize(children.size());
+
+    for (std::size_t node = 0; node < children.size(); node++) {
+        mNodes[node].mAccept = accept[node];
+        mNodes[node].mEdges = mBytes.size();
+        mNodes[node].mEdgeCount = children[node].size();
+
+        for (std::pair<const unsigned char, int>& edge : children[node]) {
+            mBytes.push_back(edge.first);
+            mTargets.push_back(edge.second);
+        }
+    }
+
+    // Children are always created after their parent, so a reverse sweep
+    // sees every subtree before its root.
+    for (int node = mNodes.size() - 1; node >= 0; node--) {
+        int best = INT_MAX;
+        TrieNode& n = mNodes[node];
+
+        for (int e = n.mEdges; e < n.mEdges + n.mEdgeCount; e++) {
+            const TrieNode& child = mNodes[mTargets[e]];
+            best = std::min(best, child.mMinBelow);
+            if (child.mAccept >= 0)
+                best = std::min(best, child.mAccept);
+        }
+
+        n.mMinBelow = best;
+    }
+}
+
+int LiteralTrie::match(const char* begin, const char* end, const char** stop) const {
+    const TrieNode* node = &mNodes[0];
+    int best = node->mAccept;
+    const char* p = begin;
+
+    for (; p != end; ++p) {
+        if (best >= 0 && best < node->mMinBelow)
+            break;
+
+        const unsigned char* first = mBytes.data() + node->mEdges;
+        const unsigned char* last = first + node->mEdgeCount;
+        const unsigned char* edge = std::lower_bound(first, last, static_cast<unsigned char>(*p));
+
+        if (edge == last || *edge != static_cast<unsigned char>(*p))
+            break;
+
+        node = &mNodes[mTargets[edge - mBytes.data()]];
+
+        if (node->mAccept >= 0 && (best < 0 || node->mAccept < best))
+            best = node->mAccept;
+    }
+
+    if (stop != nullptr)
+        *stop = p;
+
+    return best;
+}
+
+std::size_t LiteralTrie::size() const {
+    return mNodes.size();
+}
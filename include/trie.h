@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Iguana {
+    // Ordered choice over string literals in a single pass: walks the input
+    // down a byte trie and returns the index of the first literal, in the
+    // original order, that is a prefix of the input.
+    class LiteralTrie {
+    private:
+        struct TrieNode {
+            int mAccept;
+            int mMinBelow;
+            int mEdges;
+            int mEdgeCount;
+        };
+
+        std::vector<TrieNode> mNodes;
+        std::vector<unsigned char> mBytes;
+        std::vector<int> mTargets;
+
+    public:
+        LiteralTrie(const std::vector<std::string>&);
+
+        // Returns -1 when no literal matches. When stop is given it receives
+        // the last position examined, or end if the walk reached it.
+        int match(const char*, const char*, const char** = nullptr) const;
+        std::size_t size() const;
+    };
+}
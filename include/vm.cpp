@@ -0,0 +1,865 @@
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "vm.h"
+#include "iguana.h"
+#include "context.h"
+#include "arena.h"
+#include "compiledregex.h"
+#include "lineindex.h"
+#include "scan.h"
+#include "leftrecursion.h"
+
+using namespace Iguana;
+
+static const unsigned int UNBOUNDED = UINT_MAX;
+static const std::size_t NO_START = static_cast<std::size_t>(-1);
+
+namespace {
+    struct Entry {
+        int mPc;
+        std::size_t mPos;
+        int mCaps;
+        int mFrame;
+        unsigned int mCounter;
+        bool mChoice;
+        bool mHidden;
+        std::size_t mStart;
+        FailureMark mMark;
+    };
+
+    enum class CapKind : unsigned char {
+        Open,
+        OpenOr,
+        Close,
+        Leaf,
+        Empty,
+    };
+
+    struct Capture {
+        CapKind mKind;
+        int mRule;
+        std::size_t mStart;
+        std::size_t mEnd;
+    };
+}
+
+// Captures are handed to a handler in batches of at least this many.
+static const std::size_t FLUSH_BATCH = 256;
+
+namespace {
+    // Turns captures into handler events the way the tree is built from
+    // them: an Or whose alternative is unnamed is replaced by it, under
+    // the Or's name.
+    class Emitter {
+    private:
+        ParseHandler* mHandler;
+        std::string_view mInput;
+
+        // Names of the open nodes; nullptr for an Or that gave way.
+        std::vector<const std::string*> mOpen;
+
+        // An Or is only announced once its alternative shows whether it
+        // stays.
+        const std::string* mPending;
+        std::size_t mPendingStart;
+
+    public:
+        Emitter(ParseHandler* handler, std::string_view input)
+            : mHandler(handler), mInput(input), mPending(nullptr), mPendingStart(0)
+        {}
+
+        void emit(const Capture& cap, const std::string* name) {
+            if (cap.mKind == CapKind::Close) {
+                if (mPending != nullptr) {
+                    mHandler->enterRule(*mPending, mPendingStart);
+                    mPending = nullptr;
+                }
+
+                const std::string* open = mOpen.back();
+                mOpen.pop_back();
+
+                if (open != nullptr)
+                    mHandler->exitRule(*open, cap.mEnd);
+                return;
+            }
+
+            if (mPending != nullptr) {
+                if (name->empty()) {
+                    name = mPending;
+                    mOpen.back() = nullptr;
+                } else {
+                    mHandler->enterRule(*mPending, mPendingStart);
+                }
+
+                mPending = nullptr;
+            }
+
+            switch (cap.mKind) {
+                case CapKind::Open:
+                    mHandler->enterRule(*name, cap.mStart);
+                    mOpen.push_back(name);
+                    break;
+                case CapKind::OpenOr:
+                    mOpen.push_back(name);
+                    mPending = name;
+                    mPendingStart = cap.mStart;
+                    break;
+                default:
+                    mHandler->leaf(*name, mInput.substr(cap.mStart, cap.mEnd - cap.mStart));
+                    break;
+            }
+        }
+    };
+}
+
+struct Program::Machine {
+    std::vector<Entry> mStack;
+    std::vector<Capture> mCaps;
+    int mPc;
+    std::size_t mPos;
+    int mFrame;
+    std::size_t mBegin;
+
+    // Set when parsing into a handler; captures are flushed to it once
+    // there are mFlushAt of them.
+    std::unique_ptr<Emitter> mEmitter;
+    std::size_t mFlushAt;
+
+    Machine(std::size_t begin)
+        : mPc(0), mPos(begin), mFrame(-1), mBegin(begin), mFlushAt(SIZE_MAX)
+    {
+        mStack.reserve(64);
+        mCaps.reserve(256);
+    }
+};
+
+Program::Program() {}
+
+// Sends the captures no backtracking can take back to the handler and
+// drops them. Only a choice point or a hidden call truncates captures, and
+// their marks grow up the stack, so the lowest one bounds what is final.
+void Program::flush(Machine& m, bool all) {
+    std::vector<Capture>& caps = m.mCaps;
+    std::size_t safe = caps.size();
+
+    if (!all) {
+        for (const Entry& e : m.mStack) {
+            if (e.mChoice || e.mHidden) {
+                safe = e.mCaps;
+                break;
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < safe; ++i) {
+        const Capture& cap = caps[i];
+        m.mEmitter->emit(cap, cap.mKind == CapKind::Close ? nullptr : &mRules[cap.mRule].mName);
+    }
+
+    caps.erase(caps.begin(), caps.begin() + safe);
+
+    for (Entry& e : m.mStack)
+        e.mCaps = e.mCaps > static_cast<int>(safe) ? e.mCaps - safe : 0;
+
+    m.mFlushAt = caps.size() + FLUSH_BATCH;
+}
+
+int Program::ruleId(Parser* p) {
+    auto it = mRuleIds.find(p);
+    if (it != mRuleIds.end())
+        return it->second;
+
+    int id = mRules.size();
+    mRules.push_back(Rule{ p, p->mName, -1 });
+    mRuleIds[p] = id;
+    return id;
+}
+
+int Program::emit(Op op, int arg, int aux) {
+    mCode.push_back(Instruction{ op, arg, aux });
+    return mCode.size() - 1;
+}
+
+bool Program::isLeaf(Parser* p) {
+    switch (p->mType) {
+        case PTypes::String:
+        case PTypes::Alphabetic:
+        case PTypes::Alphanumeric:
+        case PTypes::Digit:
+        case PTypes::Custom:
+        case PTypes::Class:
+        case PTypes::Regex:
+        case PTypes::EndOfFile:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void Program::emitLeaf(Parser* p, int rule) {
+    emit(Op::Skip);
+
+    switch (p->mType) {
+        case PTypes::String:
+            mLiterals.push_back(p->mToParse);
+            emit(Op::Literal, mLiterals.size() - 1, rule);
+            break;
+
+        case PTypes::Regex:
+            mRegexes.push_back(p->mRegex);
+            emit(Op::Regex, mRegexes.size() - 1, rule);
+            break;
+
+        case PTypes::EndOfFile:
+            emit(Op::Eof, 0, rule);
+            break;
+
+        default:
+            mClasses.push_back(p->mClass);
+            emit(Op::Span, mClasses.size() - 1, rule);
+            break;
+    }
+}
+
+// Leaves are expanded in place; a dropped leaf carries its rule id
+// complemented so failures can still name it.
+void Program::emitCall(Parser* p, bool hidden) {
+    if (isLeaf(p)) {
+        emitLeaf(p, hidden ? ~ruleId(p) : ruleId(p));
+        return;
+    }
+
+    emit(hidden ? Op::CallHidden : Op::Call, 0, ruleId(p));
+}
+
+// Calls p between min and max times. The iteration count lives in the
+// current rule's frame, so each rule holds at most one repeat.
+void Program::emitRepeat(Parser* p, unsigned int min, unsigned int max) {
+    int choice = emit(Op::Choice);
+    int loop = mCode.size();
+    int guard = -1;
+
+    if (max != UNBOUNDED)
+        guard = emit(Op::JumpGE, 0, max);
+
+    emitCall(p, false);
+    emit(Op::Inc);
+    emit(Op::PartialCommit, loop);
+
+    int pop = -1;
+    if (guard >= 0) {
+        pop = emit(Op::Commit);
+        mCode[guard].mArg = pop;
+    }
+
+    int end = mCode.size();
+    mCode[choice].mArg = end;
+    if (pop >= 0)
+        mCode[pop].mArg = end;
+
+    if (min > 0)
+        emit(Op::FailLT, 0, min);
+}
+
+void Program::compileRule(int id) {
+    Parser* p = mRules[id].mParser;
+    mRules[id].mEntry = mCode.size();
+
+    if (isLeaf(p)) {
+        emitLeaf(p, id);
+        emit(Op::Ret);
+        return;
+    }
+
+    emit(Op::Skip);
+
+    switch (p->mType) {
+        case PTypes::And:
+            emit(Op::Open, id);
+            for (std::size_t i = 0; i < p->mParsers.size(); ++i)
+                emitCall(p->mParsers[i], !p->toInclude[i]);
+            emit(Op::Close);
+            break;
+
+        case PTypes::Or: {
+            if (p->mParsers.empty()) {
+                emit(Op::Fail);
+                break;
+            }
+
+            emit(Op::OpenOr, id);
+
+            std::vector<int> commits;
+            for (std::size_t i = 0; i + 1 < p->mParsers.size(); ++i) {
+                int choice = emit(Op::Choice);
+                emitCall(p->mParsers[i], false);
+                commits.push_back(emit(Op::Commit));
+                mCode[choice].mArg = mCode.size();
+            }
+
+            emitCall(p->mParsers.back(), false);
+
+            for (int c : commits)
+                mCode[c].mArg = mCode.size();
+
+            emit(Op::CloseOr, id);
+            break;
+        }
+
+        case PTypes::Many:
+            emit(Op::Open, id);
+            emitRepeat(p->mParsers[0], 1, UNBOUNDED);
+            emit(Op::Close);
+            break;
+
+        case PTypes::Closure: {
+            emit(Op::Open, id);
+            int choice = emit(Op::Choice);
+            emit(Op::Open, id);
+            emitRepeat(p->mParsers[0], 1, UNBOUNDED);
+            emit(Op::Close);
+            int commit = emit(Op::Commit);
+            mCode[choice].mArg = mCode.size();
+            mCode[commit].mArg = mCode.size();
+            emit(Op::Close);
+            break;
+        }
+
+        case PTypes::Until: {
+            emit(Op::Open, id);
+            int loop = emit(Op::Choice);
+            emitCall(p->mParsers[1], true);
+            int done = emit(Op::BackCommit);
+            mCode[loop].mArg = mCode.size();
+            emitCall(p->mParsers[0], true);
+            emit(Op::Jump, loop);
+            mCode[done].mArg = mCode.size();
+            emit(Op::Close);
+            break;
+        }
+
+        case PTypes::Number:
+            emit(Op::Open, id);
+            emitRepeat(p->mParsers[0], p->mLowerAmt, p->mLowerAmt);
+            emit(Op::Close);
+            break;
+
+        case PTypes::Range:
+            emit(Op::Open, id);
+            emitRepeat(p->mParsers[0], p->mLowerAmt, p->mUpperAmt);
+            emit(Op::Close);
+            break;
+
+        case PTypes::MoreThan:
+            emit(Op::Open, id);
+            emitRepeat(p->mParsers[0], p->mLowerAmt + 1, UNBOUNDED);
+            emit(Op::Close);
+            break;
+
+        case PTypes::LessThan:
+            emit(Op::Open, id);
+            emitRepeat(p->mParsers[0], 1, p->mUpperAmt > 0 ? p->mUpperAmt - 1 : 0);
+            emit(Op::Close);
+            break;
+
+        default:
+            if (mError.empty())
+                mError = p->mName + " Parser is unassigned";
+            emit(Op::Fail);
+            break;
+    }
+
+    emit(Op::Ret);
+}
+
+Program* Program::compile(Parser* root) {
+    Program* prog = new Program();
+
+    prog->emit(Op::Call, 0, prog->ruleId(root));
+    prog->emit(Op::End);
+
+    for (std::size_t i = 0; i < prog->mRules.size(); ++i)
+        prog->compileRule(i);
+
+    for (Instruction& inst : prog->mCode) {
+        if (inst.mOp == Op::Call || inst.mOp == Op::CallHidden)
+            inst.mArg = prog->mRules[inst.mAux].mEntry;
+    }
+
+    // The machine has no seed growing, so it would call such a rule forever.
+    if (prog->mError.empty()) {
+        LeftRecursion lr(std::vector<Parser*>{ root });
+
+        if (!lr.leaders().empty())
+            prog->mError = lr.leaders()[0]->mName + " Parser is left recursive";
+    }
+
+    return prog;
+}
+
+// Unless the input is final, an instruction whose outcome depends on bytes
+// past the end suspends before taking effect and runs again on resume.
+RuleResult* Program::run(CodeTracker* trckr, Machine& m, bool final) {
+    ParseContext* ctx = trckr->mCtx;
+    std::string_view input = trckr->input();
+    const char* data = input.data();
+    const std::size_t len = input.length();
+
+    std::vector<Entry>& stack = m.mStack;
+    std::vector<Capture>& caps = m.mCaps;
+
+    const Instruction* code = mCode.data();
+    int pc = m.mPc;
+    const std::size_t begin = m.mBegin;
+    std::size_t pos = m.mPos;
+    int frame = m.mFrame;
+
+    while (true) {
+        const Instruction& inst = code[pc];
+
+        switch (inst.mOp) {
+            case Op::Skip: {
+                std::size_t n = scanWhitespace(data + pos, data + len);
+
+                if (!final && pos + n == len)
+                    goto suspend;
+
+                pos += n;
+                ++pc;
+                continue;
+            }
+
+            case Op::Call:
+            case Op::CallHidden:
+                stack.push_back(Entry{ pc + 1, pos, static_cast<int>(caps.size()), frame, 0,
+                                       false, inst.mOp == Op::CallHidden, NO_START, ctx->failureMark() });
+                frame = stack.size() - 1;
+                pc = inst.mArg;
+                continue;
+
+            case Op::Ret: {
+                const Entry& e = stack.back();
+                if (e.mHidden)
+                    caps.resize(e.mCaps);
+                frame = e.mFrame;
+                pc = e.mPc;
+                stack.pop_back();
+
+                if (caps.size() >= m.mFlushAt)
+                    flush(m, false);
+                continue;
+            }
+
+            case Op::Choice:
+                stack.push_back(Entry{ inst.mArg, pos, static_cast<int>(caps.size()), frame, 0,
+                                       true, false, NO_START, FailureMark{} });
+                ++pc;
+                continue;
+
+            case Op::Commit:
+                stack.pop_back();
+                pc = inst.mArg;
+
+                if (caps.size() >= m.mFlushAt)
+                    flush(m, false);
+                continue;
+
+            case Op::PartialCommit:
+                stack.back().mPos = pos;
+                stack.back().mCaps = caps.size();
+                pc = inst.mArg;
+
+                if (caps.size() >= m.mFlushAt)
+                    flush(m, false);
+                continue;
+
+            case Op::BackCommit:
+                pos = stack.back().mPos;
+                caps.resize(stack.back().mCaps);
+                stack.pop_back();
+                pc = inst.mArg;
+                continue;
+
+            case Op::Jump:
+                pc = inst.mArg;
+                continue;
+
+            case Op::Fail:
+                break;
+
+            case Op::Literal: {
+                const std::string& lit = mLiterals[inst.mArg];
+                std::size_t n = lit.length();
+
+                if (len - pos < n) {
+                    if (!final && std::memcmp(data + pos, lit.data(), len - pos) == 0)
+                        goto suspend;
+                    break;
+                }
+
+                if (std::memcmp(data + pos, lit.data(), n) != 0)
+                    break;
+
+                if (inst.mAux >= 0)
+                    caps.push_back(Capture{ CapKind::Leaf, inst.mAux, pos, pos + n });
+                pos += n;
+                ++pc;
+                continue;
+            }
+
+            case Op::Span: {
+                std::size_t n = mClasses[inst.mArg].scan(data + pos, data + len);
+
+                if (!final && pos + n == len)
+                    goto suspend;
+
+                if (n == 0)
+                    break;
+
+                if (inst.mAux >= 0)
+                    caps.push_back(Capture{ CapKind::Leaf, inst.mAux, pos, pos + n });
+                pos += n;
+                ++pc;
+                continue;
+            }
+
+            case Op::Regex: {
+                if (pos >= len) {
+                    if (!final)
+                        goto suspend;
+                    break;
+                }
+
+                const char* stop;
+                std::size_t n = mRegexes[inst.mArg]->match(data + pos, data + len, &stop);
+
+                if (!final && stop == data + len)
+                    goto suspend;
+
+                if (n == CompiledRegex::npos || n == 0)
+                    break;
+
+                if (inst.mAux >= 0)
+                    caps.push_back(Capture{ CapKind::Leaf, inst.mAux, pos, pos + n });
+                pos += n;
+                ++pc;
+                continue;
+            }
+
+            case Op::Eof:
+                if (pos < len)
+                    break;
+
+                if (!final)
+                    goto suspend;
+
+                if (inst.mAux >= 0)
+                    caps.push_back(Capture{ CapKind::Empty, inst.mAux, pos, pos });
+                ++pc;
+                continue;
+
+            case Op::Open:
+                caps.push_back(Capture{ CapKind::Open, inst.mArg, pos, pos });
+                ++pc;
+                continue;
+
+            case Op::OpenOr:
+                caps.push_back(Capture{ CapKind::OpenOr, inst.mArg, pos, pos });
+                stack[frame].mStart = pos;
+                ++pc;
+                continue;
+
+            case Op::Close:
+                caps.push_back(Capture{ CapKind::Close, -1, pos, pos });
+                ++pc;
+                continue;
+
+            case Op::CloseOr: {
+                caps.push_back(Capture{ CapKind::Close, -1, pos, pos });
+
+                const Entry& f = stack[frame];
+                if (ctx->failedSince(f.mMark, f.mStart))
+                    ctx->expect(mRules[inst.mArg].mParser, f.mStart, f.mMark);
+                ++pc;
+                continue;
+            }
+
+            case Op::Inc:
+                ++stack[frame].mCounter;
+                ++pc;
+                continue;
+
+            case Op::JumpGE:
+                pc = stack[frame].mCounter >= static_cast<unsigned int>(inst.mAux) ? inst.mArg : pc + 1;
+                continue;
+
+            case Op::FailLT:
+                if (stack[frame].mCounter < static_cast<unsigned int>(inst.mAux))
+                    break;
+                ++pc;
+                continue;
+
+            case Op::FailLE:
+                if (stack[frame].mCounter <= static_cast<unsigned int>(inst.mAux))
+                    break;
+                ++pc;
+                continue;
+
+            case Op::End:
+                goto success;
+        }
+
+        switch (inst.mOp) {
+            case Op::Literal:
+            case Op::Span:
+            case Op::Regex:
+            case Op::Eof:
+                ctx->expect(mRules[inst.mAux >= 0 ? inst.mAux : ~inst.mAux].mParser, pos);
+                break;
+            default:
+                break;
+        }
+
+        // Or rules unwound here failed as a whole and stand in for their
+        // alternatives, as in Parser::parseOr.
+        while (!stack.empty() && !stack.back().mChoice) {
+            const Entry& e = stack.back();
+            if (e.mStart != NO_START && ctx->failedSince(e.mMark, e.mStart))
+                ctx->expect(mRules[mCode[e.mPc - 1].mAux].mParser, e.mStart, e.mMark);
+            stack.pop_back();
+        }
+
+        if (stack.empty()) {
+            trckr->mIdx = pos;
+
+            RuleResult* res = ctx->make<RuleResult>();
+            return res->failure(mRules[0].mParser->failureMessage(trckr, begin));
+        }
+
+        const Entry& e = stack.back();
+        pc = e.mPc;
+        pos = e.mPos;
+        caps.resize(e.mCaps);
+        frame = e.mFrame;
+        stack.pop_back();
+    }
+
+suspend:
+    m.mPc = pc;
+    m.mPos = pos;
+    m.mFrame = frame;
+    return nullptr;
+
+success:
+    trckr->mIdx = pos;
+
+    if (m.mEmitter != nullptr) {
+        flush(m, true);
+        return ctx->make<RuleResult>()->success(nullptr);
+    }
+
+    // Size every child list up front so nodes can be built in place.
+    std::vector<int> counts(caps.size(), 0);
+    std::vector<int> open;
+
+    for (std::size_t i = 0; i < caps.size(); ++i) {
+        CapKind kind = caps[i].mKind;
+
+        if (kind == CapKind::Close) {
+            open.pop_back();
+            continue;
+        }
+
+        if (!open.empty())
+            ++counts[open.back()];
+
+        if (kind == CapKind::Open || kind == CapKind::OpenOr)
+            open.push_back(i);
+    }
+
+    struct Parent {
+        Node* mNode;
+        Node* mChildren;
+        std::size_t mCount;
+    };
+
+    LineIndex* lines = trckr->mLines.get();
+    std::pmr::polymorphic_allocator<Node> alloc(ctx->arena());
+    std::vector<Parent> parents;
+    Node* root = nullptr;
+
+    for (std::size_t i = 0; i < caps.size(); ++i) {
+        const Capture& cap = caps[i];
+
+        if (cap.mKind == CapKind::Close) {
+            Parent parent = parents.back();
+            parents.pop_back();
+
+            Node* node = parent.mNode;
+            node->mNodes = NodeList(parent.mChildren, parent.mCount);
+            node->mEnd = cap.mEnd;
+
+            if (caps[open.back()].mKind == CapKind::OpenOr && node->mNodes[0].mName.empty()) {
+                Node child(node->mNodes[0], alloc);
+                child.mName = node->mName;
+                *node = child;
+            }
+
+            open.pop_back();
+            continue;
+        }
+
+        Node* node;
+        if (parents.empty()) {
+            node = ctx->make<Node>(mRules[cap.mRule].mName);
+            root = node;
+        } else {
+            Parent& parent = parents.back();
+            node = parent.mChildren + parent.mCount++;
+            alloc.construct(node, mRules[cap.mRule].mName);
+        }
+
+        node->mLines = lines;
+        node->mStart = cap.mStart;
+        node->mEnd = cap.mEnd;
+
+        if (cap.mKind == CapKind::Leaf) {
+            node->setValue(input.substr(cap.mStart, cap.mEnd - cap.mStart));
+        } else if (cap.mKind != CapKind::Empty) {
+            Node* children = counts[i] == 0 ? nullptr : alloc.allocate(counts[i]);
+            parents.push_back(Parent{ node, children, 0 });
+            open.push_back(i);
+        }
+    }
+
+    return ctx->make<RuleResult>()->success(root);
+}
+
+ParseResult* Program::parse(CodeTracker* trckr) {
+    return parse(trckr, nullptr);
+}
+
+ParseResult* Program::parse(CodeTracker* trckr, ParseHandler* handler) {
+    if (!mError.empty()) {
+        ParseResult* res = new ParseResult();
+        return res->failure(mError);
+    }
+
+    ParseContext localCtx;
+    ParseContext* ctx = trckr->mCtx;
+    if (ctx == nullptr) {
+        ctx = &localCtx;
+        trckr->mCtx = ctx;
+    }
+
+    ctx->clearFailures();
+    Machine m(trckr->mIdx);
+    if (handler != nullptr) {
+        m.mEmitter.reset(new Emitter(handler, trckr->input()));
+        m.mFlushAt = FLUSH_BATCH;
+    }
+
+    RuleResult* pres = run(trckr, m, true);
+
+    ParseResult* res = new ParseResult();
+    res->mNode = pres->mNode;
+    res->mError = pres->mError;
+    res->mMsg = pres->mMsg;
+    res->mArena = ctx->release();
+    res->mLines = trckr->mLines;
+
+    if (ctx == &localCtx)
+        trckr->mCtx = nullptr;
+
+    return res;
+}
+
+std::size_t Program::size() const {
+    return mCode.size();
+}
+
+void Program::display() const {
+    static const char* names[] = {
+        "skip", "call", "callhidden", "ret", "choice", "commit", "partialcommit",
+        "backcommit", "jump", "fail", "literal", "span", "regex", "eof", "open",
+        "openor", "close", "closeor", "inc", "jumpge", "faillt", "faille", "end",
+    };
+
+    for (std::size_t pc = 0; pc < mCode.size(); ++pc) {
+        for (const Rule& r : mRules) {
+            if (r.mEntry == static_cast<int>(pc))
+                std::cout << r.mName << ":" << std::endl;
+        }
+
+        const Instruction& inst = mCode[pc];
+        std::cout << "  " << pc << "\t" << names[static_cast<int>(inst.mOp)]
+                  << " " << inst.mArg << " " << inst.mAux << std::endl;
+    }
+}
+
+PushParser::PushParser(Program* program)
+    : mProgram(program), mTrckr(&mInput), mCtx(new ParseContext()),
+    mMachine(new Program::Machine(0)), mResult(nullptr), mStatus(PushStatus::NeedMore)
+{
+    mTrckr.mCtx = mCtx.get();
+
+    if (!program->mError.empty()) {
+        mResult = new ParseResult();
+        mResult->failure(program->mError);
+        mStatus = PushStatus::Failure;
+    }
+}
+
+PushParser::~PushParser() {
+    delete mResult;
+}
+
+PushStatus PushParser::feed(std::string_view bytes) {
+    if (mStatus != PushStatus::NeedMore)
+        return mStatus;
+
+    mInput.append(bytes);
+    return resume(false);
+}
+
+PushStatus PushParser::finish() {
+    return resume(true);
+}
+
+PushStatus PushParser::resume(bool final) {
+    if (mStatus != PushStatus::NeedMore)
+        return mStatus;
+
+    RuleResult* pres = mProgram->run(&mTrckr, *mMachine, final);
+    if (pres == nullptr)
+        return mStatus;
+
+    mResult = new ParseResult();
+    mResult->mNode = pres->mNode;
+    mResult->mError = pres->mError;
+    mResult->mMsg = pres->mMsg;
+    mResult->mArena = mCtx->release();
+    mResult->mLines = mTrckr.mLines;
+
+    // The buffer belongs to this parser, so the result gets its own copy.
+    mResult->materialize();
+
+    mStatus = mResult->mError ? PushStatus::Failure : PushStatus::Success;
+    return mStatus;
+}
+
+PushStatus PushParser::status() const {
+    return mStatus;
+}
+
+ParseResult* PushParser::result() {
+    ParseResult* res = mResult;
+    mResult = nullptr;
+    return res;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "iguana.h"
+#include "charclass.h"
+#include "codetracker.h"
+
+namespace Iguana {
+    class CompiledRegex;
+    class ParseContext;
+
+    // Receives a parse as events instead of a tree: the nodes the tree
+    // would have, in document order. Leaf spans point into the input.
+    class ParseHandler {
+    public:
+        virtual ~ParseHandler() = default;
+
+        virtual void enterRule(const std::string&, std::size_t) {}
+        virtual void leaf(const std::string&, std::string_view) {}
+        virtual void exitRule(const std::string&, std::size_t) {}
+    };
+
+    enum class Op : unsigned char {
+        Skip,
+        Call,
+        CallHidden,
+        Ret,
+        Choice,
+        Commit,
+        PartialCommit,
+        BackCommit,
+        Jump,
+        Fail,
+        Literal,
+        Span,
+        Regex,
+        Eof,
+        Open,
+        OpenOr,
+        Close,
+        CloseOr,
+        Inc,
+        JumpGE,
+        FailLT,
+        FailLE,
+        End,
+    };
+
+    struct Instruction {
+        Op mOp;
+        std::int32_t mArg;
+        std::int32_t mAux;
+    };
+
+    // A parser graph lowered to a flat instruction array and run by a
+    // backtracking interpreter, in the style of a PEG virtual machine.
+    //
+    // Every reachable Parser becomes a rule entered through Call. Leaf
+    // matchers take a rule id in mAux (complemented when the node is
+    // dropped) and record a capture; Open/Close bracket interior nodes. Captures are
+    // truncated on backtrack and turned into a Node tree once the parse
+    // succeeds, so the result matches GlobalParserTable::parse node for node.
+    // Memoization flags on the source parsers are ignored, and a left-
+    // recursive grammar compiles to a program whose parses fail with an
+    // error saying so.
+    class Program {
+    private:
+        struct Rule {
+            Parser* mParser;
+            std::string mName;
+            int mEntry;
+        };
+
+        std::vector<Instruction> mCode;
+        std::vector<Rule> mRules;
+        std::map<Parser*, int> mRuleIds;
+        std::vector<std::string> mLiterals;
+        std::vector<CharClass> mClasses;
+        std::vector<std::shared_ptr<const CompiledRegex>> mRegexes;
+        std::string mError;
+
+        // Registers, backtrack stack and captures of a run, kept apart so a
+        // run can stop for more input and pick up again.
+        struct Machine;
+
+        void flush(Machine&, bool);
+
+        Program();
+
+        int ruleId(Parser*);
+        int emit(Op, int = 0, int = 0);
+        bool isLeaf(Parser*);
+        void emitLeaf(Parser*, int);
+        void emitCall(Parser*, bool);
+        void emitRepeat(Parser*, unsigned int, unsigned int);
+        void compileRule(int);
+
+        // Returns nullptr when the run stopped at the end of input that is
+        // not final; calling again with more input resumes it.
+        RuleResult* run(CodeTracker*, Machine&, bool);
+
+    public:
+        static Program* compile(Parser*);
+
+        ParseResult* parse(CodeTracker*);
+
+        // Parses without building a tree, handing each node to the handler
+        // as soon as no backtracking can undo it; events of alternatives
+        // that end up failing are never sent. Memory follows how far the
+        // grammar backtracks rather than the size of the tree. On failure
+        // the handler has seen the events up to the point of no return.
+        ParseResult* parse(CodeTracker*, ParseHandler*);
+
+        std::size_t size() const;
+        void display() const;
+
+        friend class PushParser;
+    };
+
+    enum class PushStatus : char {
+        NeedMore,
+        Success,
+        Failure,
+    };
+
+    // Runs a Program over input that arrives in pieces. feed() carries the
+    // parse as far as the bytes so far decide it and suspends where it needs
+    // more, keeping the VM state so nothing is parsed twice. finish() marks
+    // the end of input. Once the status is Success or Failure, result()
+    // hands over the ParseResult, with the same tree and message a whole
+    // parse would give.
+    class PushParser {
+    private:
+        Program* mProgram;
+        std::string mInput;
+        CodeTracker mTrckr;
+        std::unique_ptr<ParseContext> mCtx;
+        std::unique_ptr<Program::Machine> mMachine;
+        ParseResult* mResult;
+        PushStatus mStatus;
+
+        PushStatus resume(bool);
+
+    public:
+        PushParser(Program*);
+        PushParser(const PushParser&) = delete;
+        PushParser& operator=(const PushParser&) = delete;
+        ~PushParser();
+
+        PushStatus feed(std::string_view);
+        PushStatus finish();
+        PushStatus status() const;
+        ParseResult* result();
+    };
+}
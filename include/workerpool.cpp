@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "workerpool.h"
+
+using namespace Iguana;
+
+// Pools whose jobs the current thread is inside, innermost last.
+static thread_local std::vector<const WorkerPool*> running;
+
+static bool inside(const WorkerPool* pool) {
+    return std::find(running.begin(), running.end(), pool) != running.end();
+}
+
+static std::uint64_t pack(std::uint64_t begin, std::uint64_t end) {
+    return begin << 32 | end;
+}
+
+WorkerPool::Worker::Worker()
+    : mRange(0)
+{}
+
+WorkerPool::WorkerPool(unsigned int threads)
+    : mJobs(0), mActive(0), mRunning(0), mStopping(false), mJob(nullptr)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned int i = 0; i < threads; i++)
+        mWorkers.emplace_back(new Worker());
+
+    for (std::size_t i = 1; i < mWorkers.size(); i++)
+        mWorkers[i]->mThread = std::thread(&WorkerPool::loop, this, i);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        mStopping = true;
+    }
+
+    mStart.notify_all();
+
+    for (std::unique_ptr<Worker>& w : mWorkers) {
+        if (w->mThread.joinable())
+            w->mThread.join();
+    }
+}
+
+WorkerPool* WorkerPool::shared() {
+    static WorkerPool pool;
+    return &pool;
+}
+
+std::size_t WorkerPool::threads() const {
+    return mWorkers.size();
+}
+
+bool WorkerPool::take(Worker* w, std::size_t& idx) {
+    std::uint64_t range = w->mRange.load();
+
+    while (true) {
+        std::uint64_t begin = range >> 32;
+        std::uint64_t end = range & 0xffffffff;
+
+        if (begin >= end)
+            return false;
+
+        if (w->mRange.compare_exchange_weak(range, pack(begin + 1, end))) {
+            idx = begin;
+            return true;
+        }
+    }
+}
+
+// Moves the back half of another worker's range to worker self and takes
+// the first index of it.
+bool WorkerPool::steal(std::size_t self, std::size_t& idx) {
+    for (std::size_t i = 1; i < mActive; i++) {
+        Worker* victim = mWorkers[(self + i) % mActive].get();
+        std::uint64_t range = victim->mRange.load();
+
+        while (true) {
+            std::uint64_t begin = range >> 32;
+            std::uint64_t end = range & 0xffffffff;
+
+            if (begin >= end)
+                break;
+
+            std::uint64_t split = end - (end - begin + 1) / 2;
+
+            if (victim->mRange.compare_exchange_weak(range, pack(begin, split))) {
+                // Nobody touches an empty range, so a plain store is enough.
+                mWorkers[self]->mRange.store(pack(split + 1, end));
+                idx = split;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void WorkerPool::work(std::size_t self) {
+    Worker* w = mWorkers[self].get();
+    std::size_t idx;
+
+    running.push_back(this);
+
+    try {
+        while (take(w, idx) || steal(self, idx))
+            (*mJob)(self, idx);
+    } catch (...) {
+        std::lock_guard<std::mutex> guard(mLock);
+
+        if (!mError)
+            mError = std::current_exception();
+    }
+
+    running.pop_back();
+}
+
+void WorkerPool::loop(std::size_t self) {
+    std::uint64_t seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            mStart.wait(lock, [&]() { return mStopping || (mJobs != seen && self < mActive); });
+
+            if (mStopping)
+                return;
+
+            seen = mJobs;
+        }
+
+        work(self);
+
+        {
+            std::lock_guard<std::mutex> guard(mLock);
+            mRunning--;
+        }
+
+        mFinish.notify_one();
+    }
+}
+
+// Runs a job with mRun held.
+void WorkerPool::start(std::size_t count, const Job& job, std::size_t workers) {
+    if (count > 0xffffffff)
+        throw "WorkerPool job too large";
+
+    std::size_t n = workers == 0 ? mWorkers.size() : std::min(workers, mWorkers.size());
+    n = std::max<std::size_t>(1, std::min(n, count));
+
+    std::exception_ptr error;
+
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        mJob = &job;
+        mError = nullptr;
+        mActive = n;
+
+        for (std::size_t i = 0; i < n; i++)
+            mWorkers[i]->mRange.store(pack(count * i / n, count * (i + 1) / n));
+
+        mRunning = n - 1;
+        mJobs++;
+    }
+
+    if (n > 1)
+        mStart.notify_all();
+
+    work(0);
+
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+        mFinish.wait(lock, [&]() { return mRunning == 0; });
+        mJob = nullptr;
+        error = mError;
+        mError = nullptr;
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void WorkerPool::run(std::size_t count, const Job& job, std::size_t workers) {
+    if (inside(this))
+        throw "WorkerPool::run called from inside one of its jobs";
+
+    std::lock_guard<std::mutex> guard(mRun);
+    start(count, job, workers);
+}
+
+bool WorkerPool::tryRun(std::size_t count, const Job& job, std::size_t workers) {
+    if (inside(this))
+        return false;
+
+    std::unique_lock<std::mutex> guard(mRun, std::try_to_lock);
+    if (!guard.owns_lock())
+        return false;
+
+    start(count, job, workers);
+    return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Iguana {
+    // Threads that live as long as the pool and run one job at a time over
+    // a range of indices. Each worker starts a job on an even share of the
+    // range; a worker that runs out takes half of what another has left, so
+    // a few slow indices do not hold up the rest.
+    class WorkerPool {
+    public:
+        // Called with the worker running it and the index to process.
+        using Job = std::function<void(std::size_t, std::size_t)>;
+
+    private:
+        struct Worker {
+            // Indices still to process, packed as begin << 32 | end so the
+            // owner and thieves can claim them with one compare-and-swap.
+            std::atomic<std::uint64_t> mRange;
+            std::thread mThread;
+
+            Worker();
+        };
+
+        std::vector<std::unique_ptr<Worker>> mWorkers;
+
+        // Held for the whole of a job, so jobs from different threads take
+        // turns.
+        std::mutex mRun;
+
+        std::mutex mLock;
+        std::condition_variable mStart;
+        std::condition_variable mFinish;
+        std::uint64_t mJobs;
+        std::size_t mActive;
+        std::size_t mRunning;
+        bool mStopping;
+        std::exception_ptr mError;
+        const Job* mJob;
+
+        bool take(Worker*, std::size_t&);
+        bool steal(std::size_t, std::size_t&);
+        void work(std::size_t);
+        void loop(std::size_t);
+        void start(std::size_t, const Job&, std::size_t);
+
+    public:
+        // threads = 0 uses one per hardware thread. The thread that runs a
+        // job counts as one of them, as worker 0.
+        WorkerPool(unsigned int = 0);
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+        ~WorkerPool();
+
+        // Calls the job once for every index below count, on at most
+        // workers threads (0 for all of them), and returns when all calls
+        // have. Rethrows the first exception a call threw. Waits for a job
+        // another thread is running to finish first.
+        void run(std::size_t, const Job&, std::size_t = 0);
+
+        // As run, but returns false without calling the job when another
+        // thread is running one, or when called from inside a job.
+        bool tryRun(std::size_t, const Job&, std::size_t = 0);
+
+        std::size_t threads() const;
+
+        // The pool parallel repetitions use unless their ParseContext names
+        // another, with one thread per hardware thread.
+        static WorkerPool* shared();
+    };
+}
@@ -0,0 +1,231 @@
+#include <any>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "iguana.h"
+#include "actions.h"
+#include "codetracker.h"
+#include "vm.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Sums of numbers, names counted as 100 per letter, and parentheses.
+static void sumActions(Actions* actions) {
+    actions->onLeaf<long>("num", [](std::string_view t) { return std::stol(std::string(t)); });
+    actions->onLeaf<long>("id", [](std::string_view t) { return static_cast<long>(t.size()) * 100; });
+    actions->onRule<long>("sum", [](Values& v) { return v.get<long>(0) + v.get<long>(2); });
+    actions->onRule<long>("paren", [](Values& v) { return v.get<long>(1); });
+}
+
+static long evaluate(const Node& n) {
+    if (n.mName == "num")
+        return std::stol(std::string(n.mValue));
+    if (n.mName == "id")
+        return static_cast<long>(n.mValue.size()) * 100;
+    if (n.mName == "sum")
+        return evaluate(n.mNodes[0]) + evaluate(n.mNodes[2]);
+    if (n.mName == "paren")
+        return evaluate(n.mNodes[1]);
+
+    return evaluate(n.mNodes[0]);
+}
+
+// expr = atom '+' expr | atom, a list of them at the top.
+static Parser* sumGrammar(GlobalParserTable* gpt) {
+    Parser* expr = gpt->Empty("expr");
+    Parser* atom = gpt->Or("atom", {
+        gpt->Digit("num"),
+        gpt->Alphabetic("id"),
+        gpt->And("paren", { gpt->String("lp", "("), expr, gpt->String("rp", ")") }),
+    });
+    Parser* sum = gpt->And("sum", { atom, gpt->String("plus", "+"), expr });
+    Parser* body = Parser::Or({ sum, atom }, "expr");
+    gpt->assign(expr, body);
+    delete body;
+
+    return gpt->Many("prog", expr);
+}
+
+// Handler events and run() over the engine's tree give each expression
+// the value the tree evaluates to.
+static void testBothPathsMatchTree() {
+    GlobalParserTable gpt;
+    Parser* top = sumGrammar(&gpt);
+    std::unique_ptr<Program> prog(gpt.compile(top));
+
+    Actions events;
+    Actions walked;
+    sumActions(&events);
+    sumActions(&walked);
+
+    const std::vector<std::string> tokens = { "1", "22", "a", "bc", "+", "(", ")", " ", "\n" };
+    std::mt19937 rng(3);
+    bool eventsOk = true;
+    bool walkedOk = true;
+    int parsed = 0;
+
+    for (int i = 0; i < 3000; i++) {
+        std::string input;
+        for (unsigned int n = rng() % 16; n > 0; n--)
+            input += tokens[rng() % tokens.size()];
+
+        CodeTracker treeTrckr(&input);
+        CodeTracker eventTrckr(&input);
+        ParseResult* tree = gpt.parse(top, &treeTrckr);
+        events.clear();
+        ParseResult* res = prog->parse(&eventTrckr, &events);
+
+        if (tree->mError != res->mError)
+            eventsOk = false;
+
+        if (!tree->mError) {
+            parsed++;
+            walked.clear();
+            walked.run(*tree->mNode);
+
+            const NodeList& exprs = tree->mNode->mNodes;
+            eventsOk = eventsOk && events.values().size() == exprs.size();
+            walkedOk = walkedOk && walked.values().size() == exprs.size();
+
+            for (std::size_t j = 0; j < exprs.size(); j++) {
+                long want = evaluate(exprs[j]);
+                eventsOk = eventsOk && j < events.values().size() && std::any_cast<long>(events.values()[j]) == want;
+                walkedOk = walkedOk && j < walked.values().size() && std::any_cast<long>(walked.values()[j]) == want;
+            }
+        }
+
+        delete tree;
+        delete res;
+    }
+
+    expect(parsed > 0, "some random inputs parse");
+    expect(eventsOk, "actions on Program events give the tree's values");
+    expect(walkedOk, "actions run over the engine's tree give the tree's values");
+}
+
+// The VM refuses expr = expr '-' num | num, so a left-associative
+// subtraction is evaluated from the engine's tree.
+static void testLeftRecursiveTree() {
+    GlobalParserTable gpt;
+    Parser* num = gpt.Regex("num", "[0-9]+");
+    Parser* expr = gpt.Empty("expr");
+    Parser* sub = gpt.And("sub", { expr, gpt.String("minus", "-"), num });
+    Parser* body = Parser::Or({ sub, num }, "expr");
+    gpt.assign(expr, body);
+    delete body;
+    gpt.analyze();
+
+    Actions actions;
+    actions.onLeaf<long>("num", [](std::string_view t) { return std::stol(std::string(t)); });
+    actions.onRule<long>("sub", [](Values& v) { return v.get<long>(0) - v.get<long>(2); });
+
+    std::string input = "10 - 2 - 3";
+    CodeTracker trckr(&input);
+    ParseResult* res = gpt.parse(expr, &trckr);
+    expect(!res->mError, "left-recursive subtraction parses");
+    if (!res->mError) {
+        actions.run(*res->mNode);
+        expect(actions.take<long>() == 5, "subtraction is evaluated left to right");
+    }
+    delete res;
+
+    std::string chain = "0";
+    for (int i = 0; i < 20000; i++)
+        chain += "-1";
+
+    CodeTracker chainTrckr(&chain);
+    res = gpt.parse(expr, &chainTrckr);
+    expect(!res->mError, "a long chain parses");
+    if (!res->mError) {
+        actions.clear();
+        actions.run(*res->mNode);
+        expect(actions.take<long>() == -20000, "a long chain is evaluated without recursing");
+    }
+    delete res;
+
+    std::unique_ptr<Program> prog(gpt.compile(expr));
+    CodeTracker vmTrckr(&input);
+    actions.clear();
+    res = prog->parse(&vmTrckr, &actions);
+    expect(res->mError && actions.values().empty(), "the VM runs no actions for a left-recursive grammar");
+    delete res;
+}
+
+// Rules without actions pass their children's values on, leaves without
+// them give their text, and a childless rule still gets its rule action.
+static void testDefaults() {
+    GlobalParserTable gpt;
+    Parser* words = gpt.Many("words", gpt.Alphabetic("word"));
+    Parser* empty = gpt.Closure("empty", gpt.Digit("digit"));
+    Parser* top = gpt.And("top", { gpt.String("lb", "["), words, empty, gpt.String("rb", "]") });
+
+    Actions actions;
+    actions.onRule<std::size_t>("words", [](Values& v) { return v.size(); });
+    actions.onRule<std::size_t>("empty", [](Values& v) { return v.size() + 100; });
+
+    std::string input = "[a b c]";
+    CodeTracker trckr(&input);
+    ParseResult* res = gpt.parse(top, &trckr);
+    expect(!res->mError, "list parses");
+    if (!res->mError) {
+        actions.run(*res->mNode);
+
+        std::vector<std::any>& values = actions.values();
+        expect(values.size() == 4, "a rule without an action passes its children's values on");
+        if (values.size() == 4) {
+            expect(std::any_cast<std::string_view>(values[0]) == "[", "a leaf without an action gives its text");
+            expect(std::any_cast<std::size_t>(values[1]) == 3, "a rule's action gets one value per child");
+            expect(std::any_cast<std::size_t>(values[2]) == 100, "a childless rule gets its action with no values");
+        }
+    }
+    delete res;
+}
+
+// Values are std::any, so asking for the wrong type throws.
+static void testWrongTypeThrows() {
+    GlobalParserTable gpt;
+    Parser* num = gpt.Digit("num");
+
+    Actions actions;
+    actions.onLeaf<long>("num", [](std::string_view t) { return std::stol(std::string(t)); });
+
+    std::string input = "42";
+    CodeTracker trckr(&input);
+    ParseResult* res = gpt.parse(num, &trckr);
+    actions.run(*res->mNode);
+    delete res;
+
+    bool threw = false;
+    try {
+        actions.take<int>();
+    } catch (const std::bad_any_cast&) {
+        threw = true;
+    }
+    expect(threw, "taking a value as the wrong type throws std::bad_any_cast");
+}
+
+int main() {
+    testBothPathsMatchTree();
+    testLeftRecursiveTree();
+    testDefaults();
+    testWrongTypeThrows();
+
+    if (failures == 0)
+        std::printf("actions_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "iguana.h"
+#include "batchparser.h"
+#include "frozengrammar.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// The tree with lines and columns, or the error message.
+static void dump(const Node& n, std::string& s) {
+    s += std::string(n.mName) + "|" + std::string(n.mValue) + "|" + std::to_string(n.lin()) + ":" + std::to_string(n.col()) + "{";
+
+    for (const Node& child : n.mNodes)
+        dump(child, s);
+
+    s += "}";
+}
+
+static std::string show(ParseResult* res) {
+    std::string s;
+    if (res->mError)
+        s = "error " + std::string(res->mMsg);
+    else
+        dump(*res->mNode, s);
+    return s;
+}
+
+// rec = key '=' val ';' | '{' rec+ '}' as ROOT.
+static GlobalParserTable* records() {
+    GlobalParserTable* gpt = new GlobalParserTable();
+    Parser* val = gpt->Or("val", { gpt->Digit("num"), gpt->Regex("str", "\"[a-z ]*\""), gpt->String("t", "true") });
+    Parser* rec = gpt->Empty("rec");
+    Parser* pair = gpt->And("pair", { gpt->Alphabetic("key"), gpt->String("eq", "="), val, gpt->String("semi", ";") });
+    Parser* block = gpt->And("blk", { gpt->String("lb", "{"), gpt->Many("body", rec), gpt->String("rb", "}") });
+    Parser* body = Parser::Or({ pair, block }, "rec");
+    gpt->assign(rec, body);
+    delete body;
+
+    gpt->And("ROOT", { gpt->Many("recs", rec), gpt->EndOfFile("eof") });
+    return gpt;
+}
+
+// Documents of very different sizes, so workers finish out of order and
+// steal from each other; results still come back in document order, each
+// the one a parse of that document alone gives.
+static void testResultsInDocumentOrder() {
+    FrozenGrammar grammar(records());
+    expect(grammar.valid(), "the grammar is valid");
+    BatchParser batch(&grammar, 4);
+
+    const std::vector<std::string> pieces = { "a = 1;", "b = \"x y\";", "{ c = true; }", "{ { d = 2; } e = 3; }", " ", "\n", "?", "}" };
+    std::mt19937 rng(3);
+    bool ordered = true;
+    bool same = true;
+    int errors = 0;
+    int total = 0;
+
+    for (int round = 0; round < 20; round++) {
+        std::vector<std::string> store(rng() % 200);
+        for (std::size_t i = 0; i < store.size(); i++) {
+            // Each document starts with its own index, so a result in the
+            // wrong slot shows.
+            store[i] = "n = " + std::to_string(i) + ";\n";
+            for (unsigned int n = rng() % (rng() % 7 == 0 ? 300 : 8); n > 0; n--)
+                store[i] += pieces[rng() % (rng() % 10 == 0 ? pieces.size() : 6)];
+        }
+
+        std::vector<std::string_view> docs(store.begin(), store.end());
+        std::vector<ParseResult*> results = batch.parse(docs);
+        expect(results.size() == docs.size(), "one result per document");
+
+        for (std::size_t i = 0; i < results.size(); i++) {
+            ParseResult* alone = grammar.parse(docs[i]);
+            same = same && show(results[i]) == show(alone);
+
+            if (!results[i]->mError) {
+                // ROOT > recs > rec > pair > val > num
+                const Node& pair = results[i]->mNode->mNodes[0].mNodes[0].mNodes[0];
+                ordered = ordered && pair.mNodes[2].mNodes[0].mValue == std::to_string(i);
+            }
+
+            errors += results[i]->mError ? 1 : 0;
+            total++;
+            delete alone;
+            delete results[i];
+        }
+    }
+
+    expect(errors > 0 && errors < total, "documents both pass and fail");
+    expect(ordered, "each result is in its document's slot");
+    expect(same, "each result is what parsing its document alone gives");
+}
+
+static void testEmptyBatch() {
+    FrozenGrammar grammar(records());
+    BatchParser batch(&grammar, 2);
+
+    expect(batch.parse({}).empty(), "an empty batch gives no results");
+}
+
+int main() {
+    testResultsInDocumentOrder();
+    testEmptyBatch();
+
+    if (failures == 0)
+        std::printf("batch_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
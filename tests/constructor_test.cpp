@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <string>
+#include "constructor.h"
+#include "codetracker.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Parses input with the ROOT of grammar and returns how far it got, or -1
+// on failure.
+static long parsedLength(Iguana::GlobalParserTable* gpt, std::string input) {
+    CodeTracker trckr(&input);
+    Iguana::ParseResult* res = gpt->parseRoot(&trckr);
+    long len = res->mError ? -1 : static_cast<long>(trckr.mIdx);
+    delete res;
+    return len;
+}
+
+// [a]|[b]+ is "a" or a run of "b"s. It must not turn into the class scan
+// [ab]+, which CharClass's union syntax would read it as.
+static void testAlternationIsNotAClass() {
+    auto cres = IguanaConstructor::construct("@@ A #|[a]|[b]+| @@ ROOT | A ; @@");
+    expect(!cres.mIsError, "grammar with [a]|[b]+ constructs");
+    if (cres.mIsError)
+        return;
+
+    expect(parsedLength(cres.mGpt, "aa") == 1, "[a]|[b]+ matches one a");
+    expect(parsedLength(cres.mGpt, "ab") == 1, "[a]|[b]+ stops after a");
+    expect(parsedLength(cres.mGpt, "bb") == 2, "[a]|[b]+ matches a run of b");
+    delete cres.mGpt;
+
+    auto gres = IguanaConstructor::generate("@@ A #|[a]|[b]+| @@ ROOT | A ; @@", "g");
+    expect(!gres.mIsError, "generate accepts [a]|[b]+");
+    expect(gres.mSource.find("Static::Regex<n_A") != std::string::npos, "generate keeps [a]|[b]+ a regex");
+}
+
+static void testBracketRunIsAClass() {
+    auto gres = IguanaConstructor::generate("@@ A #|[a-z\\]]+| B #|[^a]+| @@ ROOT | A B ; @@", "g");
+    expect(!gres.mIsError, "generate accepts bracket runs");
+    expect(gres.mSource.find("Static::Class<n_A") != std::string::npos, "[a-z\\]]+ becomes a class scan");
+    expect(gres.mSource.find("Static::Class<n_B") != std::string::npos, "[^a]+ becomes a class scan");
+
+    auto cres = IguanaConstructor::construct("@@ A #|[a-z\\]]+| @@ ROOT | A ; @@");
+    expect(!cres.mIsError, "grammar with [a-z\\]]+ constructs");
+    if (cres.mIsError)
+        return;
+
+    expect(parsedLength(cres.mGpt, "ab]c1") == 4, "[a-z\\]]+ matches the run");
+    delete cres.mGpt;
+}
+
+int main() {
+    testAlternationIsNotAClass();
+    testBracketRunIsAClass();
+
+    if (failures == 0)
+        std::printf("constructor_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "iguana.h"
+#include "codetracker.h"
+#include "vm.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// key '=' (num | 'true' | 'false') ';', repeated to the end of the file.
+struct Pairs {
+    GlobalParserTable mGpt;
+    Parser* mDoc;
+    std::unique_ptr<Program> mProgram;
+
+    Pairs() {
+        Parser* val = mGpt.Or("val", { mGpt.Digit("num"), mGpt.String("true", "true"), mGpt.String("false", "false") });
+        Parser* pair = mGpt.And("pair", { mGpt.Alphabetic("key"), mGpt.String("eq", "="), val, mGpt.String("semi", ";") });
+        mDoc = mGpt.And("doc", { mGpt.Many("pairs", pair), mGpt.EndOfFile("eof") });
+        mProgram.reset(mGpt.compile(mDoc));
+    }
+
+    // The engine's message, after checking the VM gives the same one.
+    std::string error(std::string input) {
+        CodeTracker trckr(&input);
+        ParseResult* res = mGpt.parse(mDoc, &trckr);
+        std::string msg = res->mError ? std::string(res->mMsg) : "";
+        delete res;
+
+        CodeTracker vmTrckr(&input);
+        res = mProgram->parse(&vmTrckr);
+        expect(msg == (res->mError ? std::string(res->mMsg) : ""), "the VM reports what the engine does");
+        delete res;
+
+        return msg;
+    }
+};
+
+// The message names what was expected where the parse got farthest, not
+// where the outermost rule gave up.
+static void testFarthestFailure() {
+    Pairs pairs;
+
+    expect(pairs.error("a = 1;\nb = 2;\n").empty(), "a whole document parses");
+
+    expect(pairs.error("a = 1;\nb 2;") == "doc Parsing Error: Expected '=' (2:3)",
+        "a missing '=' is reported inside the second pair");
+    expect(pairs.error("a = 1;\nb = ;") == "doc Parsing Error: Expected one of 'num', 'true', 'false' (2:5)",
+        "a missing value lists the alternatives");
+    expect(pairs.error("a = tru;") == "doc Parsing Error: Expected one of 'num', 'true', 'false' (1:5)",
+        "a value that matches no alternative is reported at its start");
+    expect(pairs.error("a = 1;\nb = 2\n") == "doc Parsing Error: Expected ';' (3:1)",
+        "a missing ';' is reported after the whitespace before it");
+}
+
+// Every parser that failed at the farthest offset is listed.
+static void testExpectationsAreJoined() {
+    Pairs pairs;
+
+    expect(pairs.error("a = 1; 7") == "doc Parsing Error: Expected alphabetic character or end of file (1:8)",
+        "another pair or the end of the file");
+    expect(pairs.error("") == "doc Parsing Error: Expected alphabetic character (1:1)",
+        "an empty document needs a first pair");
+}
+
+int main() {
+    testFarthestFailure();
+    testExpectationsAreJoined();
+
+    if (failures == 0)
+        std::printf("error_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "iguana.h"
+#include "codetracker.h"
+#include "flat.h"
+#include "vm.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static bool sameFlat(const FlatTree& a, const FlatTree& b) {
+    if (a.size() != b.size())
+        return false;
+
+    for (std::size_t i = 0; i < a.size(); i++) {
+        const FlatNode& x = a.at(i);
+        const FlatNode& y = b.at(i);
+
+        if (x.mStart != y.mStart || x.mEnd != y.mEnd || x.mFirstChild != y.mFirstChild || x.mNextSibling != y.mNextSibling)
+            return false;
+
+        if (a.ruleName(x.mRule) != b.ruleName(y.mRule))
+            return false;
+    }
+
+    return true;
+}
+
+// Walks the flat tree and the Node tree side by side.
+static bool matchesNode(FlatTree::Cursor c, const Node& n) {
+    if (!c.valid() || c.name() != std::string(n.mName) || c.start() != n.mStart || c.end() != n.mEnd)
+        return false;
+
+    if (n.mNodes.empty() && c.text() != n.mValue)
+        return false;
+
+    FlatTree::Cursor child = c.firstChild();
+    for (const Node& sub : n.mNodes) {
+        if (!matchesNode(child, sub))
+            return false;
+        child = child.nextSibling();
+    }
+
+    return !child.valid();
+}
+
+// rec = key '=' val ';' | '{' rec+ '}', with strings that span lines.
+struct Records {
+    GlobalParserTable mGpt;
+    Parser* mDoc;
+
+    Records() {
+        Parser* val = mGpt.Or("val", { mGpt.Digit("num"), mGpt.Regex("str", "\"[a-z \n]*\"") });
+        Parser* rec = mGpt.Empty("rec");
+        Parser* pair = mGpt.And("pair", { mGpt.Alphabetic("key"), mGpt.String("eq", "="), val, mGpt.String("semi", ";") });
+        Parser* block = mGpt.And("blk", { mGpt.String("lb", "{"), mGpt.Many("body", rec), mGpt.String("rb", "}") });
+        Parser* body = Parser::Or({ pair, block }, "rec");
+        mGpt.assign(rec, body);
+        delete body;
+
+        mDoc = mGpt.And("doc", { mGpt.Many("recs", rec), mGpt.EndOfFile("eof") });
+    }
+};
+
+static void testBuilderMatchesFromNode() {
+    Records grammar;
+    std::unique_ptr<Program> prog(grammar.mGpt.compile(grammar.mDoc));
+
+    const std::vector<std::string> lines = {
+        "a = 1;\n", "bc = \"x\ny\";\n", "{ d = 2;\n e = 3; }\n", "{\n{ q = 1; }\n}\n", "z = 12; y = 3;\n", "\n", " w = \"\n\n\";\n",
+    };
+
+    std::mt19937 rng(5);
+    int parsed = 0;
+    bool errorsAgree = true;
+    bool same = true;
+    bool walks = true;
+
+    for (int i = 0; i < 1000; i++) {
+        std::string input;
+        for (unsigned int n = 1 + rng() % 30; n > 0; n--)
+            input += lines[rng() % lines.size()];
+        if (i % 4 == 1)
+            input.insert(rng() % input.size(), "?");
+
+        CodeTracker treeTrckr(&input);
+        ParseResult* tree = grammar.mGpt.parse(grammar.mDoc, &treeTrckr);
+
+        FlatTree built(input);
+        FlatBuilder builder(&built);
+        CodeTracker flatTrckr(&input);
+        ParseResult* res = prog->parse(&flatTrckr, &builder);
+
+        errorsAgree = errorsAgree && tree->mError == res->mError;
+        if (!tree->mError && !res->mError) {
+            parsed++;
+            FlatTree converted = FlatTree::fromNode(*tree->mNode, input);
+            same = same && sameFlat(converted, built);
+            walks = walks && matchesNode(built.root(), *tree->mNode);
+        }
+
+        delete tree;
+        delete res;
+    }
+
+    expect(parsed > 0, "some random documents parse");
+    expect(errorsAgree, "FlatBuilder's parse fails where the engine's does");
+    expect(same, "FlatBuilder lays out what FlatTree::fromNode does");
+    expect(walks, "cursors over the built tree walk the Node tree");
+}
+
+// A failed parse keeps what was sent before the failure, and those nodes
+// are whole records.
+static void testFailureKeepsPrefix() {
+    Records grammar;
+    std::unique_ptr<Program> prog(grammar.mGpt.compile(grammar.mDoc));
+
+    std::string input = "a = 1;\nb = 2;\n{ c = 3; }\nd = ?";
+    FlatTree built(input);
+    FlatBuilder builder(&built);
+    CodeTracker trckr(&input);
+    ParseResult* res = prog->parse(&trckr, &builder);
+
+    expect(res->mError, "a broken document fails");
+    for (std::size_t i = 0; i < built.size(); i++)
+        expect(built.at(i).mEnd <= input.find('?'), "nodes kept after a failure end before it");
+
+    delete res;
+}
+
+int main() {
+    testBuilderMatchesFromNode();
+    testFailureKeepsPrefix();
+
+    if (failures == 0)
+        std::printf("flat_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "iguana.h"
+#include "codetracker.h"
+#include "context.h"
+#include "incremental.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// The tree with offsets, lines and columns, or the error message.
+static std::string dump(const Node& n) {
+    std::string s = std::string(n.mName) + "|" + std::string(n.mValue) + "|" + std::to_string(n.mStart) + "-"
+        + std::to_string(n.mEnd) + "@" + std::to_string(n.lin()) + ":" + std::to_string(n.col()) + "{";
+
+    for (const Node& child : n.mNodes)
+        s += dump(child);
+
+    return s + "}";
+}
+
+static std::string show(ParseResult* res) {
+    return res->mError ? "error " + std::string(res->mMsg) : dump(*res->mNode);
+}
+
+// stmt = key '=' val ';' | '{' stmt+ '}', with the rules that nest
+// memoized so reparses have subtrees to reuse.
+struct Statements {
+    GlobalParserTable mGpt;
+    Parser* mDoc;
+
+    Statements() {
+        Parser* val = mGpt.Or("val", { mGpt.Digit("num"), mGpt.Regex("str", "\"[a-z ]*\""), mGpt.String("t", "true") });
+        Parser* stmt = mGpt.Empty("stmt");
+        Parser* pair = mGpt.And("pair", { mGpt.Alphabetic("key"), mGpt.String("eq", "="), val, mGpt.String("semi", ";") });
+        Parser* block = mGpt.And("blk", { mGpt.String("lb", "{"), mGpt.Many("body", stmt), mGpt.String("rb", "}") });
+        Parser* body = Parser::Or({ pair, block }, "stmt");
+        mGpt.assign(stmt, body);
+        delete body;
+
+        mDoc = mGpt.And("doc", { mGpt.Many("stmts", stmt), mGpt.EndOfFile("eof") });
+        mGpt.memoize("stmt");
+        mGpt.memoize("val");
+        mGpt.memoize("body");
+        mGpt.analyze();
+    }
+
+    std::string full(std::string* text) {
+        CodeTracker trckr(text);
+        ParseResult* res = mGpt.parse(mDoc, &trckr);
+        std::string s = show(res);
+        delete res;
+        return s;
+    }
+};
+
+// Random edits, one or two at a time, some of which break the document.
+// After each, the reparse must give the tree or message a full parse of
+// the edited text does. Sessions run long enough for the node arena to be
+// compacted several times.
+static void testReparseMatchesFullParse() {
+    Statements grammar;
+    const std::vector<std::string> pieces = { "x = 1;\n", "{ y = 2; }\n", "{ ", "} ", "7", ";", " " };
+    std::mt19937 rng(11);
+    long mismatches = 0;
+    long compactions = 0;
+
+    for (int session = 0; session < 6; session++) {
+        std::string text;
+        for (int i = 0; i < 60; i++)
+            text += pieces[rng() % 2];
+
+        IncrementalParser parser(&grammar.mGpt, grammar.mDoc);
+        delete parser.parse(&text);
+        Arena* nodes = parser.context()->nodeArena();
+
+        for (int e = 0; e < 150; e++) {
+            std::vector<Edit> edits;
+            for (unsigned int k = 1 + rng() % 2; k > 0; k--) {
+                std::size_t start = rng() % (text.size() + 1);
+                std::size_t len = std::min<std::size_t>(rng() % 3, text.size() - start);
+                const std::string& insert = pieces[rng() % pieces.size()];
+
+                text.replace(start, len, insert);
+                edits.push_back(Edit{ start, start + len, start + insert.size() });
+            }
+
+            ParseResult* res = parser.reparse(&text, edits);
+            if (show(res) != grammar.full(&text))
+                mismatches++;
+            delete res;
+
+            if (parser.context()->nodeArena() != nodes) {
+                compactions++;
+                nodes = parser.context()->nodeArena();
+            }
+        }
+    }
+
+    expect(compactions > 0, "long sessions compact the node arena");
+    expect(mismatches == 0, "every reparse gives what a full parse of the edited text does");
+}
+
+// One edit in a large document reuses nearly everything.
+static void testEditReusesSubtrees() {
+    Statements grammar;
+    std::string text;
+    for (int i = 0; i < 500; i++)
+        text += "x = " + std::to_string(i) + ";\n{ y = 2; z = \"ab\"; }\n";
+
+    IncrementalParser parser(&grammar.mGpt, grammar.mDoc);
+    delete parser.parse(&text);
+    unsigned long fullMisses = parser.context()->mMemoMisses;
+
+    std::size_t pos = text.find("x = 250") + 4;
+    text.insert(pos, "9");
+    ParseResult* res = parser.reparse(&text, { Edit{ pos, pos, pos + 1 } });
+
+    expect(parser.context()->mMemoHits > 0, "a reparse recalls subtrees");
+    expect(parser.context()->mMemoMisses * 20 < fullMisses, "a reparse parses a small part of the document again");
+    expect(show(res) == grammar.full(&text), "the reparsed tree is the full parse's");
+    delete res;
+
+    res = parser.reparse(&text, {});
+    expect(parser.context()->mMemoMisses <= 1, "a reparse without edits recalls the whole document");
+    expect(show(res) == grammar.full(&text), "and gives the same tree again");
+    delete res;
+}
+
+int main() {
+    testReparseMatchesFullParse();
+    testEditReusesSubtrees();
+
+    if (failures == 0)
+        std::printf("incremental_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
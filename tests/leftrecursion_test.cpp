@@ -0,0 +1,209 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "iguana.h"
+#include "codetracker.h"
+#include "context.h"
+#include "vm.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Parses input with p and returns the error message, or "" on success.
+static std::string parseError(GlobalParserTable* gpt, Parser* p, std::string input) {
+    CodeTracker trckr(&input);
+    ParseResult* res = gpt->parse(p, &trckr);
+    std::string msg = res->mError ? std::string(res->mMsg) : "";
+    if (!res->mError && trckr.mIdx != input.length())
+        msg = "stopped early";
+    delete res;
+    return msg;
+}
+
+// expr = expr '-' num | num, left unassigned until the caller assigns it
+// the returned body and deletes it. The unnamed sequence leaves expr to
+// lead the cycle.
+static Parser* subtraction(GlobalParserTable* gpt, Parser** expr) {
+    Parser* num = gpt->Regex("num", "[0-9]+");
+    *expr = gpt->Empty("expr");
+
+    Parser* sub = Parser::And({ *expr, gpt->String("minus", "-"), num }, "");
+    gpt->addAnonParser(sub);
+    return Parser::Or({ sub, num }, "expr");
+}
+
+// Folds a tree of subtraction, so a tree that leans the wrong way gives a
+// different number.
+static long evaluate(const Node& n) {
+    if (n.mName == "num")
+        return std::stol(std::string(n.mValue));
+
+    if (n.mNodes.size() == 1)
+        return evaluate(n.mNodes[0]);
+
+    return evaluate(n.mNodes[0]) - evaluate(n.mNodes[2]);
+}
+
+// Parses input with p to the end and evaluates it, or returns -1000.
+static long parseAndEvaluate(GlobalParserTable* gpt, Parser* p, std::string input, ParseContext* ctx = nullptr) {
+    CodeTracker trckr(&input);
+    trckr.mCtx = ctx;
+    ParseResult* res = gpt->parse(p, &trckr);
+
+    long value = -1000;
+    if (!res->mError && trckr.mIdx == input.length())
+        value = evaluate(*res->mNode);
+
+    trckr.mCtx = nullptr;
+    delete res;
+    return value;
+}
+
+static void testDirect() {
+    GlobalParserTable gpt;
+    Parser* expr;
+    Parser* body = subtraction(&gpt, &expr);
+    gpt.assign(expr, body);
+    delete body;
+    gpt.analyze();
+
+    expect(parseAndEvaluate(&gpt, expr, "7") == 7, "direct: a lone number");
+    expect(parseAndEvaluate(&gpt, expr, "7-2") == 5, "direct: one subtraction");
+    expect(parseAndEvaluate(&gpt, expr, "10-2-3") == 5, "direct: the tree leans left");
+    expect(parseAndEvaluate(&gpt, expr, "20 - 1 - 2 - 3 - 4") == 10, "direct: a long chain leans left");
+    expect(!parseError(&gpt, expr, "1-").empty(), "direct: a dangling minus does not parse to the end");
+
+    std::string chain = "0";
+    for (int i = 0; i < 5000; i++)
+        chain += "-1";
+    expect(parseAndEvaluate(&gpt, expr, chain) == -5000, "direct: a chain of 5000 does not overflow the stack");
+}
+
+// A = B 'x' | 'a' and B = A 'y' | 'b' call each other at their start, so
+// A matches (a|bx)(yx)*.
+static void testIndirect() {
+    GlobalParserTable gpt;
+    Parser* a = gpt.Empty("A");
+    Parser* b = gpt.Empty("B");
+
+    Parser* bodyA = Parser::Or({ gpt.And("Bx", { b, gpt.String("x", "x") }), gpt.String("a", "a") }, "A");
+    Parser* bodyB = Parser::Or({ gpt.And("Ay", { a, gpt.String("y", "y") }), gpt.String("b", "b") }, "B");
+    gpt.assign(a, bodyA);
+    gpt.assign(b, bodyB);
+    delete bodyA;
+    delete bodyB;
+
+    Parser* top = gpt.And("top", { a, gpt.EndOfFile("eof") });
+    gpt.analyze();
+
+    for (const char* in : { "a", "bx", "ayx", "bxyx", "ayxyxyx" })
+        expect(parseError(&gpt, top, in).empty(), "indirect: (a|bx)(yx)* parses");
+
+    for (const char* in : { "b", "ay", "axy", "x", "bxy" })
+        expect(!parseError(&gpt, top, in).empty(), "indirect: anything else fails");
+}
+
+// The leader memoized, and reached twice at the same offset: the second
+// time is a memo hit and must give the same grown tree.
+static void testMemoizedLeader() {
+    GlobalParserTable gpt;
+    Parser* expr;
+    Parser* body = subtraction(&gpt, &expr);
+    gpt.assign(expr, body);
+    delete body;
+
+    Parser* bang = gpt.And("bang", { expr, gpt.String("excl", "!") });
+    Parser* ask = gpt.And("ask", { expr, gpt.String("qm", "?") });
+    Parser* top = gpt.Or("top", { bang, ask });
+    gpt.memoize("expr");
+    gpt.analyze();
+
+    ParseContext ctx;
+    std::string input = "10-2-3?";
+    CodeTracker trckr(&input);
+    trckr.mCtx = &ctx;
+    ParseResult* res = gpt.parse(top, &trckr);
+
+    expect(!res->mError && trckr.mIdx == input.length(), "memoized leader: parses");
+    expect(ctx.mMemoHits > 0, "memoized leader: the second alternative hits the memo");
+    if (!res->mError)
+        expect(evaluate(res->mNode->mNodes[0].mNodes[0]) == 5, "memoized leader: the recalled tree leans left");
+
+    trckr.mCtx = nullptr;
+    delete res;
+}
+
+// The VM has no seed growing, so it refuses left recursion up front
+// instead of recursing forever.
+static void testVmRejects() {
+    GlobalParserTable gpt;
+    Parser* expr;
+    Parser* body = subtraction(&gpt, &expr);
+    gpt.assign(expr, body);
+    delete body;
+    gpt.analyze();
+
+    std::unique_ptr<Program> prog(gpt.compile(expr));
+    std::string input = "1-2";
+    CodeTracker trckr(&input);
+    ParseResult* res = prog->parse(&trckr);
+
+    expect(res->mError, "VM: left recursion fails");
+    expect(std::string(res->mMsg) == "expr Parser is left recursive", "VM: the message names the rule");
+    delete res;
+}
+
+// Without left recursion nothing has to be analyzed first.
+static void testPlainGrammarNeedsNoAnalyze() {
+    GlobalParserTable gpt;
+    Parser* list = gpt.Many("list", gpt.String("x", "x"));
+
+    expect(parseError(&gpt, list, "xxx").empty(), "plain grammar parses without analyze()");
+}
+
+// parse() only reads the grammar, so a left-recursive rule added after the
+// last analyze() is reported instead of being followed forever.
+static void testChangeAfterAnalyzeIsReported() {
+    GlobalParserTable gpt;
+    Parser* expr;
+    Parser* body = subtraction(&gpt, &expr);
+    gpt.analyze();
+
+    gpt.assign(expr, body);
+    delete body;
+    std::string msg = parseError(&gpt, expr, "1-2");
+    expect(msg.find("left recursive") != std::string::npos, "left recursion added after analyze() is reported");
+
+    gpt.analyze();
+    expect(parseError(&gpt, expr, "1-2").empty(), "analyze() again makes it parse");
+
+    gpt.String("unused", "u");
+    expect(!parseError(&gpt, expr, "1-2").empty(), "any change through the table needs analyze() again");
+
+    gpt.analyze();
+    expect(parseError(&gpt, expr, "1-2").empty(), "and analyze() clears it");
+}
+
+int main() {
+    testDirect();
+    testIndirect();
+    testMemoizedLeader();
+    testVmRejects();
+    testPlainGrammarNeedsNoAnalyze();
+    testChangeAfterAnalyzeIsReported();
+
+    if (failures == 0)
+        std::printf("leftrecursion_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
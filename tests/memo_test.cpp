@@ -0,0 +1,149 @@
+#include <cstdio>
+#include <string>
+#include "iguana.h"
+#include "codetracker.h"
+#include "context.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static bool sameTree(const Node& a, const Node& b) {
+    if (a.mName != b.mName || a.mValue != b.mValue || a.mStart != b.mStart || a.mEnd != b.mEnd)
+        return false;
+
+    if (a.mNodes.size() != b.mNodes.size())
+        return false;
+
+    for (std::size_t i = 0; i < a.mNodes.size(); i++) {
+        if (!sameTree(a.mNodes[i], b.mNodes[i]))
+            return false;
+    }
+
+    return true;
+}
+
+// Two alternatives that start with the same rule: the first looks it up
+// and misses, the second finds it.
+static void testSecondAlternativeHits() {
+    GlobalParserTable gpt;
+    Parser* key = gpt.And("key", { gpt.Alphabetic("word"), gpt.String("colon", ":") });
+    Parser* bang = gpt.And("bang", { key, gpt.String("excl", "!") });
+    Parser* ask = gpt.And("ask", { key, gpt.String("qm", "?") });
+    Parser* top = gpt.Or("top", { bang, ask });
+
+    std::string input = "name: ?";
+    CodeTracker plainTrckr(&input);
+    ParseResult* plain = gpt.parse(top, &plainTrckr);
+
+    gpt.memoize("key");
+    ParseContext ctx;
+    CodeTracker trckr(&input);
+    trckr.mCtx = &ctx;
+    ParseResult* res = gpt.parse(top, &trckr);
+
+    expect(ctx.mMemoMisses == 1, "the first alternative misses");
+    expect(ctx.mMemoHits == 1, "the second alternative hits");
+    expect(!res->mError && !plain->mError, "both parses succeed");
+    if (!res->mError && !plain->mError)
+        expect(sameTree(*res->mNode, *plain->mNode), "a recalled subtree gives the tree an unmemoized parse does");
+
+    trckr.mCtx = nullptr;
+    delete res;
+    delete plain;
+}
+
+// A failure is remembered too, and recalling it reports what the first
+// attempt expected.
+static void testFailureIsRecalled() {
+    GlobalParserTable gpt;
+    Parser* key = gpt.And("key", { gpt.Alphabetic("word"), gpt.String("colon", ":") });
+    Parser* bang = gpt.And("bang", { key, gpt.String("excl", "!") });
+    Parser* ask = gpt.And("ask", { key, gpt.String("qm", "?") });
+    Parser* top = gpt.Or("top", { bang, ask });
+
+    std::string input = "name ?";
+    CodeTracker plainTrckr(&input);
+    ParseResult* plain = gpt.parse(top, &plainTrckr);
+
+    gpt.memoize("key");
+    ParseContext ctx;
+    CodeTracker trckr(&input);
+    trckr.mCtx = &ctx;
+    ParseResult* res = gpt.parse(top, &trckr);
+
+    expect(ctx.mMemoMisses == 1 && ctx.mMemoHits == 1, "the failure is looked up once and recalled once");
+    expect(res->mError && plain->mError, "both parses fail");
+    expect(res->mMsg == plain->mMsg, "a recalled failure gives the same message");
+
+    trckr.mCtx = nullptr;
+    delete res;
+    delete plain;
+}
+
+// Without memoization this grammar backtracks exponentially in the number
+// of terms; with it each rule is tried at most once per offset.
+static void testBacktrackingIsBounded() {
+    GlobalParserTable gpt;
+    Parser* num = gpt.Digit("num");
+    Parser* plus = gpt.String("plus", "+");
+    Parser* star = gpt.String("star", "*");
+    Parser* expr = gpt.Empty("expr");
+    Parser* term = gpt.Empty("term");
+
+    Parser* termBody = Parser::Or({ gpt.And("mul", { num, star, term }), gpt.And("mul2", { num, star, num }), num }, "term");
+    Parser* exprBody = Parser::Or({ gpt.And("sum", { term, plus, expr }), gpt.And("sum2", { term, plus, term }), term }, "expr");
+    gpt.assign(term, termBody);
+    gpt.assign(expr, exprBody);
+    delete termBody;
+    delete exprBody;
+
+    std::string input;
+    for (int i = 0; i < 10; i++)
+        input += "1 * 2 + ";
+    input += "3";
+
+    ParseContext plainCtx;
+    CodeTracker plainTrckr(&input);
+    plainTrckr.mCtx = &plainCtx;
+    ParseResult* plain = gpt.parse(expr, &plainTrckr);
+    expect(plainCtx.mMemoHits == 0 && plainCtx.mMemoMisses == 0, "nothing is looked up until a rule is memoized");
+
+    gpt.memoize("term");
+    gpt.memoize("expr");
+    ParseContext ctx;
+    CodeTracker trckr(&input);
+    trckr.mCtx = &ctx;
+    ParseResult* res = gpt.parse(expr, &trckr);
+
+    expect(ctx.mMemoHits > 0, "memoized rules are recalled");
+    expect(ctx.mMemoMisses <= 2 * (input.size() + 1), "each memoized rule is parsed at most once per offset");
+    expect(!res->mError && !plain->mError && trckr.mIdx == input.size(), "both parses read the whole input");
+    if (!res->mError && !plain->mError)
+        expect(sameTree(*res->mNode, *plain->mNode), "memoization does not change the tree");
+
+    plainTrckr.mCtx = nullptr;
+    trckr.mCtx = nullptr;
+    delete res;
+    delete plain;
+}
+
+int main() {
+    testSecondAlternativeHits();
+    testFailureIsRecalled();
+    testBacktrackingIsBounded();
+
+    if (failures == 0)
+        std::printf("memo_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
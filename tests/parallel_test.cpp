@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "iguana.h"
+#include "codetracker.h"
+#include "context.h"
+#include "workerpool.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// The tree with offsets, lines and columns.
+static void dump(const Node& n, std::string& s) {
+    s += std::string(n.mName) + "|" + std::string(n.mValue) + "|" + std::to_string(n.mStart) + "-"
+        + std::to_string(n.mEnd) + "@" + std::to_string(n.lin()) + ":" + std::to_string(n.col()) + "{";
+
+    for (const Node& child : n.mNodes)
+        dump(child, s);
+
+    s += "}";
+}
+
+static std::string parseWith(GlobalParserTable* gpt, Parser* doc, WorkerPool* pool, std::string* input) {
+    ParseContext ctx;
+    ctx.mPool = pool;
+    CodeTracker trckr(input);
+    trckr.mCtx = &ctx;
+    ParseResult* res = gpt->parse(doc, &trckr);
+
+    std::string s;
+    if (res->mError)
+        s = "error " + std::string(res->mMsg);
+    else
+        dump(*res->mNode, s);
+
+    trckr.mCtx = nullptr;
+    delete res;
+    return s;
+}
+
+// Records cut at newlines, including newlines inside strings and blocks,
+// where a cut does not fall between items and the chunk is parsed again.
+// Inputs are large enough to be split into several chunks.
+static void testParallelMatchesSerial() {
+    GlobalParserTable gpt;
+    Parser* val = gpt.Or("val", { gpt.Digit("num"), gpt.Regex("str", "\"[a-z \n]*\"") });
+    Parser* rec = gpt.Empty("rec");
+    Parser* pair = gpt.And("pair", { gpt.Alphabetic("key"), gpt.String("eq", "="), val, gpt.String("semi", ";") });
+    Parser* block = gpt.And("blk", { gpt.String("lb", "{"), gpt.Many("body", rec), gpt.String("rb", "}") });
+    Parser* body = Parser::Or({ pair, block }, "rec");
+    gpt.assign(rec, body);
+    delete body;
+    Parser* doc = gpt.And("doc", { gpt.Many("recs", rec), gpt.EndOfFile("eof") });
+
+    const std::vector<std::string> lines = {
+        "a = 1;\n", "bc = \"x\ny\";\n", "{ d = 2;\n e = 3; }\n", "{\n{ q = 1; }\n}\n", "z = 12; y = 3;\n", "\n", " w = \"\n\n\";\n",
+    };
+
+    WorkerPool pool(4);
+    std::mt19937 rng(11);
+    int mismatches = 0;
+    int errors = 0;
+    const int runs = 12;
+
+    for (int i = 0; i < runs; i++) {
+        std::string input;
+        std::size_t target = 150000 + rng() % 250000;
+        while (input.size() < target)
+            input += lines[rng() % lines.size()];
+
+        if (i % 3 == 1)
+            input.insert(rng() % input.size(), "?");
+        if (i % 4 == 2)
+            input = "{\n" + input + "}\n";
+
+        // Without a sync string the repetition runs serially.
+        gpt.parallelize("recs", "", 0);
+        std::string serial = parseWith(&gpt, doc, &pool, &input);
+        gpt.parallelize("recs", "\n", 4);
+        std::string parallel = parseWith(&gpt, doc, &pool, &input);
+
+        errors += serial.compare(0, 6, "error ") == 0 ? 1 : 0;
+        mismatches += serial == parallel ? 0 : 1;
+    }
+
+    expect(errors > 0 && errors < runs, "inputs both pass and fail");
+    expect(mismatches == 0, "a parallel parse gives the serial tree or message");
+}
+
+int main() {
+    testParallelMatchesSerial();
+
+    if (failures == 0)
+        std::printf("parallel_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
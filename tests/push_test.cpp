@@ -0,0 +1,155 @@
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "iguana.h"
+#include "codetracker.h"
+#include "vm.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// The tree with offsets, lines and columns, or the error message.
+static std::string dump(const Node& n) {
+    std::string s = std::string(n.mName) + "|" + std::string(n.mValue) + "|" + std::to_string(n.mStart) + "-"
+        + std::to_string(n.mEnd) + "@" + std::to_string(n.lin()) + ":" + std::to_string(n.col()) + "{";
+
+    for (const Node& child : n.mNodes)
+        s += dump(child);
+
+    return s + "}";
+}
+
+static std::string show(ParseResult* res) {
+    return res->mError ? "error " + std::string(res->mMsg) : dump(*res->mNode);
+}
+
+// Feeds input in pieces of 1 to maxChunk bytes and returns what the push
+// parser ends with.
+static std::string pushed(Program* prog, const std::string& input, std::mt19937& rng, std::size_t maxChunk) {
+    PushParser parser(prog);
+    PushStatus status = PushStatus::NeedMore;
+    std::size_t i = 0;
+
+    while (i < input.size() && status == PushStatus::NeedMore) {
+        std::size_t k = 1 + rng() % maxChunk;
+        status = parser.feed(std::string_view(input).substr(i, k));
+        i += k;
+    }
+
+    parser.finish();
+    ParseResult* res = parser.result();
+    std::string s = show(res);
+    delete res;
+
+    return s;
+}
+
+// Every combinator the VM lowers, fed in random pieces, gives the tree or
+// message of a one-shot parse of the same program.
+static void testChunksMatchOneShot() {
+    GlobalParserTable gpt;
+    Parser* num = gpt.Digit("num");
+    Parser* id = gpt.Alphabetic("id");
+    Parser* expr = gpt.Empty("expr");
+    Parser* atom = gpt.Or("atom", { num, id, gpt.And("paren", { gpt.String("lp", "("), expr, gpt.String("rp", ")") }) });
+    Parser* sum = gpt.And("sum", { atom, gpt.String("plus", "+"), expr });
+    Parser* body = Parser::Or({ sum, atom }, "expr");
+    gpt.assign(expr, body);
+    delete body;
+
+    Parser* range = gpt.Range("rng", gpt.Custom("cust", "xyz"), 1, 3);
+    Parser* moreThan = gpt.MoreThan("mt", gpt.Digit("dg"), 1);
+    Parser* number = gpt.Number("nb", gpt.Regex("re", "[a-c]+"), 2);
+    Parser* closure = gpt.Closure("cl", gpt.String("kw", "if"));
+    Parser* lessThan = gpt.LessThan("lt", gpt.String("semi", ";"), 3);
+    Parser* until = gpt.Until("un", gpt.Alphanumeric("w"), gpt.String("end", "end"));
+    Parser* all = gpt.And("all", { range, moreThan, number, closure, lessThan, until, gpt.EndOfFile("eof") });
+    Parser* top = gpt.Or("top", { all, gpt.Many("prog", expr) });
+
+    std::vector<std::unique_ptr<Program>> programs;
+    for (Parser* p : { top, all, sum, range, lessThan, until, closure, moreThan })
+        programs.emplace_back(gpt.compile(p));
+
+    const std::vector<std::string> tokens = {
+        "1", "22", "a", "bc", "+", "(", ")", " ", "\n", "x", "y", "z", "if", ";", "end", "ab", "cab", "w9",
+    };
+
+    std::mt19937 rng(11);
+    long mismatches = 0;
+    long errors = 0;
+    long runs = 0;
+
+    for (int i = 0; i < 2000; i++) {
+        std::string input;
+        for (unsigned int n = rng() % 14; n > 0; n--)
+            input += tokens[rng() % tokens.size()];
+        if (i == 0)
+            input = "xx y z 1 2 3 ab cab if if ; ; w1 end";
+
+        for (const auto& prog : programs) {
+            std::string text = input;
+            CodeTracker trckr(&text);
+            ParseResult* res = prog->parse(&trckr);
+            std::string want = show(res);
+            errors += res->mError ? 1 : 0;
+            delete res;
+
+            runs++;
+            if (pushed(prog.get(), input, rng, 1 + i % 6) != want)
+                mismatches++;
+        }
+    }
+
+    expect(errors > 0 && errors < runs, "random inputs both pass and fail");
+    expect(mismatches == 0, "chunked input gives the one-shot tree or message");
+}
+
+// The status says when the bytes so far decide the parse.
+static void testStatus() {
+    GlobalParserTable gpt;
+    Parser* greeting = gpt.And("greeting", { gpt.String("hello", "hello"), gpt.Alphabetic("name"), gpt.String("stop", ".") });
+    std::unique_ptr<Program> prog(gpt.compile(greeting));
+
+    PushParser ok(prog.get());
+    expect(ok.feed("hel") == PushStatus::NeedMore, "a prefix needs more");
+    expect(ok.feed("lo wor") == PushStatus::NeedMore, "a name may go on");
+    expect(ok.feed("ld.") == PushStatus::Success, "the full stop decides it");
+    ParseResult* res = ok.result();
+    expect(!res->mError && res->mNode->mNodes[1].mValue == "world", "the name spans both pieces");
+    delete res;
+
+    PushParser bad(prog.get());
+    expect(bad.feed("help") == PushStatus::Failure, "a wrong byte fails without waiting for more");
+    res = bad.result();
+    expect(res->mError, "the failure has a message");
+    delete res;
+
+    PushParser cut(prog.get());
+    cut.feed("hello bob");
+    expect(cut.finish() == PushStatus::Failure, "input cut short fails at finish()");
+    res = cut.result();
+    delete res;
+}
+
+int main() {
+    testChunksMatchOneShot();
+    testStatus();
+
+    if (failures == 0)
+        std::printf("push_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+#include "compiledregex.h"
+
+// Differential test of CompiledRegex against std::regex (ECMAScript) on
+// random inputs. A match is anchored at the start of the input and picks
+// the leftmost-first alternative, the way regex_search with
+// match_continuous does. Build with the sources in include/ and run; exits
+// non-zero on a mismatch.
+
+using namespace Iguana;
+
+int main() {
+    // Natively compiled forms first, then ones that fall back to std::regex.
+    const std::vector<std::string> patterns = {
+        "[0-9]+", "a|ab", "ab|a", "a*", "a*?", "(a|b)*c", "a+?b", "[a-c]+",
+        "x{2,3}", "x{2,}", "x{2}", "(ab){1,2}?a", "\\d+\\.\\d*", "[^ab]+",
+        ".*", ".+?x", "(a*)*b", "(a|ab)(c|bcd)", "[\\w]+", "\\s*x", "^ab",
+        "(?:a|b)+", "[a-]+", "[-a]+", "\"([^\"\\\\]|\\\\.)*\"", "(x+x+)+y",
+        "[\\d\\-]+", "\\x41+", "a{0,3}?b", "(|a)+", "(a|)+b", "[a]|[b]+",
+        "[a-z_][a-z0-9_]*", "0x[0-9a-f]+|[0-9]+",
+        "a$", "\\bab", "(a)\\1", "[]a]",
+    };
+
+    const char alphabet[] = "abcx0129 .\n\"\\-y_fA";
+    std::mt19937 rng(1);
+    long checks = 0;
+    long bad = 0;
+
+    for (const std::string& pattern : patterns) {
+        CompiledRegex compiled(pattern);
+        std::regex reference(pattern);
+
+        for (int k = 0; k < 5000; k++) {
+            std::string input;
+            int length = rng() % 14;
+            for (int i = 0; i < length; i++)
+                input += alphabet[rng() % (sizeof(alphabet) - 1)];
+
+            const char* begin = input.data();
+            const char* end = begin + input.size();
+
+            std::cmatch m;
+            std::size_t expected = std::regex_search(begin, end, m, reference, std::regex_constants::match_continuous)
+                ? static_cast<std::size_t>(m.length(0))
+                : CompiledRegex::npos;
+            std::size_t got = compiled.match(begin, end);
+
+            checks++;
+            if (expected != got) {
+                if (bad++ < 20) {
+                    std::fprintf(stderr, "MISMATCH /%s/ on \"%s\": expected %ld, got %ld\n",
+                        pattern.c_str(), input.c_str(), static_cast<long>(expected), static_cast<long>(got));
+                }
+            }
+        }
+    }
+
+    std::printf("regex_test: %ld checks, %ld mismatches\n", checks, bad);
+    return bad == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "iguana.h"
+#include "codetracker.h"
+#include "vm.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Writes down events in the same form as writeTree(), checking that
+// every exitRule closes the rule last entered.
+class Recorder : public ParseHandler {
+private:
+    std::string_view mInput;
+    std::vector<std::string> mOpen;
+
+public:
+    std::string mEvents;
+    bool mBalanced = true;
+
+    Recorder(std::string_view input)
+        : mInput(input)
+    {}
+
+    void enterRule(const std::string& name, std::size_t start) override {
+        mEvents += "(" + name + "@" + std::to_string(start);
+        mOpen.push_back(name);
+    }
+
+    void leaf(const std::string& name, std::string_view text) override {
+        mBalanced = mBalanced && text.data() >= mInput.data() && text.data() + text.size() <= mInput.data() + mInput.size();
+        mEvents += "[" + name + "@" + std::to_string(text.data() - mInput.data()) + ":" + std::string(text) + "]";
+    }
+
+    void exitRule(const std::string& name, std::size_t end) override {
+        mBalanced = mBalanced && !mOpen.empty() && mOpen.back() == name;
+        if (!mOpen.empty())
+            mOpen.pop_back();
+        mEvents += "@" + std::to_string(end) + ")";
+    }
+
+    bool closed() const {
+        return mOpen.empty();
+    }
+};
+
+// The events a handler should get for a tree: rules around their
+// children, and leaves with their text.
+static void writeTree(const Node& n, bool leaf, std::string& s) {
+    if (leaf) {
+        s += "[" + std::string(n.mName) + "@" + std::to_string(n.mStart) + ":" + std::string(n.mValue) + "]";
+        return;
+    }
+
+    s += "(" + std::string(n.mName) + "@" + std::to_string(n.mStart);
+    for (const Node& child : n.mNodes)
+        writeTree(child, child.mNodes.empty(), s);
+    s += "@" + std::to_string(n.mEnd) + ")";
+}
+
+// Random inputs through an expression grammar with a list around it. Every
+// rule here has children, so the tree alone says which nodes are leaves.
+static void testEventsMatchTree() {
+    GlobalParserTable gpt;
+    Parser* expr = gpt.Empty("expr");
+    Parser* atom = gpt.Or("atom", { gpt.Digit("num"), gpt.Alphabetic("id"),
+        gpt.And("paren", { gpt.String("lp", "("), expr, gpt.String("rp", ")") }) });
+    Parser* sum = gpt.And("sum", { atom, gpt.String("plus", "+"), expr });
+    Parser* body = Parser::Or({ sum, atom }, "expr");
+    gpt.assign(expr, body);
+    delete body;
+
+    Parser* assign = Parser::And({ gpt.Alphabetic("name"), gpt.String("eq", "=") }, "", { true, false });
+    gpt.addAnonParser(assign);
+    Parser* item = gpt.Or("item", { assign, expr });
+    Parser* top = gpt.Many("prog", item);
+    std::unique_ptr<Program> prog(gpt.compile(top));
+
+    const std::vector<std::string> tokens = { "1", "22", "a", "bc", "+", "(", ")", " ", "\n", "=" };
+    std::mt19937 rng(7);
+    int parsed = 0;
+    bool errorsAgree = true;
+    bool same = true;
+    bool balanced = true;
+
+    // The last input is long enough for events to be sent in several
+    // batches during the parse.
+    for (int i = 0; i <= 3000; i++) {
+        std::string input;
+        for (unsigned int n = rng() % 16; n > 0; n--)
+            input += tokens[rng() % tokens.size()];
+        if (i == 3000) {
+            input.clear();
+            for (int k = 0; k < 20000; k++)
+                input += " x = a + (1 + bc)\n";
+        }
+
+        CodeTracker treeTrckr(&input);
+        ParseResult* tree = prog->parse(&treeTrckr);
+
+        Recorder recorder(input);
+        CodeTracker eventTrckr(&input);
+        ParseResult* res = prog->parse(&eventTrckr, &recorder);
+
+        errorsAgree = errorsAgree && tree->mError == res->mError && tree->mMsg == res->mMsg;
+        if (!tree->mError && !res->mError) {
+            parsed++;
+            std::string want;
+            writeTree(*tree->mNode, false, want);
+            same = same && recorder.mEvents == want;
+            balanced = balanced && recorder.mBalanced && recorder.closed();
+        }
+
+        delete tree;
+        delete res;
+    }
+
+    expect(parsed > 1, "some random inputs and the long one parse");
+    expect(errorsAgree, "a parse with a handler fails as one without does");
+    expect(same, "events describe the tree the same program builds");
+    expect(balanced, "every rule is closed where it was opened, and leaves point into the input");
+}
+
+// An alternative that fails sends no events.
+static void testNoEventsForUndoneAlternatives() {
+    GlobalParserTable gpt;
+    Parser* call = gpt.And("call", { gpt.Alphabetic("fn"), gpt.String("lp", "("), gpt.String("rp", ")") });
+    Parser* top = gpt.Or("top", { call, gpt.Alphabetic("word") });
+    std::unique_ptr<Program> prog(gpt.compile(top));
+
+    std::string input = "name";
+    Recorder recorder(input);
+    CodeTracker trckr(&input);
+    ParseResult* res = prog->parse(&trckr, &recorder);
+
+    expect(!res->mError, "a plain word parses");
+    expect(recorder.mEvents == "(top@0[word@0:name]@4)", "the failed call sends no events");
+    delete res;
+}
+
+int main() {
+    testEventsMatchTree();
+    testNoEventsForUndoneAlternatives();
+
+    if (failures == 0)
+        std::printf("sax_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
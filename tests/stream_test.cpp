@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "iguana.h"
+#include "stream.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Items of different lengths read 16 bytes at a time, so the window is
+// compacted many times between items. Offsets plus base() must land on
+// the item in the whole input, whatever the window held at the time.
+static void testOffsetsAcrossCompaction() {
+    GlobalParserTable gpt;
+    Parser* item = gpt.And("item", { gpt.Alphabetic("key"), gpt.String("semi", ";") });
+
+    std::string input;
+    std::vector<std::size_t> starts;
+    std::vector<std::string> keys;
+
+    for (int i = 0; i < 200; i++) {
+        std::string key(1 + i % 23, static_cast<char>('a' + i % 26));
+        starts.push_back(input.size());
+        keys.push_back(key);
+        input += key + ";";
+        input += i % 3 == 0 ? "\n" : " ";
+    }
+
+    std::istringstream in(input);
+    StreamSource src(in, 16);
+    std::size_t count = 0;
+    bool compacted = false;
+    bool offsets = true;
+    bool values = true;
+    bool lines = true;
+
+    ParseResult* res = gpt.parseEach(item, &src, [&](ParseResult* r) {
+        const Node* n = r->mNode;
+        std::size_t at = n->mStart + src.base();
+
+        compacted = compacted || src.base() > 0;
+        offsets = offsets && count < starts.size() && at == starts[count]
+            && n->mEnd - n->mStart == keys[count].size() + 1;
+        values = values && n->mNodes[0].mValue == keys[count];
+
+        std::size_t line = 1 + std::count(input.begin(), input.begin() + at, '\n');
+        lines = lines && n->lin() == line;
+
+        count++;
+        delete r;
+        return true;
+    });
+
+    expect(res == nullptr, "stream parses to the end");
+    delete res;
+
+    expect(count == starts.size(), "every item is handed over");
+    expect(compacted, "the window is compacted during the stream");
+    expect(offsets, "offsets plus base() are input offsets");
+    expect(values, "values are the items' keys");
+    expect(lines, "lines are counted over the whole input");
+}
+
+// Returning false from the callback still consumes the item it was given.
+static void testStopConsumesItem() {
+    GlobalParserTable gpt;
+    Parser* item = gpt.And("item", { gpt.Alphabetic("key"), gpt.String("semi", ";") });
+
+    std::istringstream in("ab; cd; ef;");
+    StreamSource src(in, 4);
+    std::string seen;
+
+    ParseResult* res = gpt.parseEach(item, &src, [&](ParseResult* r) {
+        seen += std::string(r->mNode->mNodes[0].mValue);
+        delete r;
+        return seen.size() < 4;
+    });
+
+    expect(res == nullptr, "stopping returns nullptr");
+    expect(seen == "abcd", "items up to the stop are handed over");
+
+    res = gpt.parseEach(item, &src, [&](ParseResult* r) {
+        seen += std::string(r->mNode->mNodes[0].mValue);
+        delete r;
+        return true;
+    });
+
+    expect(res == nullptr, "the rest of the stream parses");
+    expect(seen == "abcdef", "parsing resumes after the last item handed over");
+}
+
+int main() {
+    testOffsetsAcrossCompaction();
+    testStopConsumesItem();
+
+    if (failures == 0)
+        std::printf("stream_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "iguana.h"
+#include "codetracker.h"
+#include "vm.h"
+
+// Build with the sources in include/ and run; exits non-zero on failure.
+
+using namespace Iguana;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static bool sameTree(const Node& a, const Node& b) {
+    if (a.mName != b.mName || a.mValue != b.mValue || a.mStart != b.mStart || a.mEnd != b.mEnd)
+        return false;
+
+    if (a.mNodes.size() != b.mNodes.size())
+        return false;
+
+    for (std::size_t i = 0; i < a.mNodes.size(); i++) {
+        if (!sameTree(a.mNodes[i], b.mNodes[i]))
+            return false;
+    }
+
+    return true;
+}
+
+// Counts the inputs on which the engine and the program disagree about
+// success, the error message, the tree or how far they read.
+struct Differential {
+    GlobalParserTable* mGpt;
+    std::vector<std::pair<Parser*, std::unique_ptr<Program>>> mPrograms;
+    long mRuns = 0;
+    long mErrors = 0;
+    long mMismatches = 0;
+
+    void add(Parser* p) {
+        mPrograms.emplace_back(p, std::unique_ptr<Program>(mGpt->compile(p)));
+    }
+
+    void run(const std::string& input) {
+        for (std::size_t i = 0; i < mPrograms.size(); i++) {
+            auto& entry = mPrograms[i];
+            std::string text = input;
+            CodeTracker engineTrckr(&text);
+            CodeTracker vmTrckr(&text);
+            ParseResult* engine = mGpt->parse(entry.first, &engineTrckr);
+            ParseResult* vm = entry.second->parse(&vmTrckr);
+
+            bool same = engine->mError == vm->mError;
+            if (same && engine->mError)
+                same = engine->mMsg == vm->mMsg;
+            else if (same)
+                same = sameTree(*engine->mNode, *vm->mNode) && engineTrckr.mIdx == vmTrckr.mIdx;
+
+            if (!same && mMismatches == 0)
+                std::fprintf(stderr, "first mismatch: parser %zu on \"%s\"\n", i, input.c_str());
+
+            mRuns++;
+            mErrors += engine->mError ? 1 : 0;
+            mMismatches += same ? 0 : 1;
+            delete engine;
+            delete vm;
+        }
+    }
+};
+
+// Every combinator the VM lowers, including an anonymous sequence with an
+// omitted child, checked on random token soup and on one input that gets
+// through the long sequence.
+static void testRandomInputs() {
+    GlobalParserTable gpt;
+    Parser* num = gpt.Digit("num");
+    Parser* id = gpt.Alphabetic("id");
+    Parser* plus = gpt.String("plus", "+");
+    Parser* expr = gpt.Empty("expr");
+
+    Parser* atom = gpt.Or("atom", { num, id, gpt.And("paren", { gpt.String("lp", "("), expr, gpt.String("rp", ")") }) });
+    Parser* sum = gpt.And("sum", { atom, plus, expr });
+    Parser* body = Parser::Or({ sum, atom }, "expr");
+    gpt.assign(expr, body);
+    delete body;
+
+    Parser* range = gpt.Range("rng", gpt.Custom("cust", "xyz"), 1, 3);
+    Parser* moreThan = gpt.MoreThan("mt", gpt.Digit("dg"), 1);
+    Parser* number = gpt.Number("nb", gpt.Regex("re", "[a-c]+"), 2);
+    Parser* closure = gpt.Closure("cl", gpt.String("kw", "if"));
+    Parser* lessThan = gpt.LessThan("lt", gpt.String("semi", ";"), 3);
+    Parser* until = gpt.Until("un", gpt.Alphanumeric("w"), gpt.String("end", "end"));
+    Parser* all = gpt.And("all", { range, moreThan, number, closure, lessThan, until, gpt.EndOfFile("eof") });
+
+    Parser* assign = Parser::And({ id, gpt.String("eq", "=") }, "", { true, false });
+    gpt.addAnonParser(assign);
+    Parser* choice = gpt.Or("orr", { assign, num, plus });
+    Parser* top = gpt.Or("top", { all, gpt.Many("m2", choice) });
+
+    Differential diff;
+    diff.mGpt = &gpt;
+    for (Parser* p : { gpt.Many("prog", expr), all, choice, top, sum, atom, range, lessThan, until, closure, moreThan })
+        diff.add(p);
+
+    const std::vector<std::string> tokens = {
+        "1", "22", "a", "bc", "+", "(", ")", " ", "\n", "x", "y", "z", "if", ";", "end", "=", "ab", "cab", "w9",
+    };
+
+    std::mt19937 rng(7);
+    for (int i = 0; i < 5000; i++) {
+        std::string input;
+        for (unsigned int n = rng() % 14; n > 0; n--)
+            input += tokens[rng() % tokens.size()];
+        diff.run(input);
+    }
+    diff.run("xx y z 1 2 3 ab cab if if ; ; w1 end");
+
+    expect(diff.mErrors > 0 && diff.mErrors < diff.mRuns, "random inputs both pass and fail");
+    expect(diff.mMismatches == 0, "the program gives the engine's tree or message on every input");
+}
+
+// Thousands of lines keep the VM's node stack growing and truncating well
+// past its first allocation.
+static void testLargeInput() {
+    GlobalParserTable gpt;
+    Parser* line = gpt.And("line", { gpt.Alphabetic("key"), gpt.String("eq", "="), gpt.Digit("val") });
+    Parser* file = gpt.Many("file", line);
+    std::unique_ptr<Program> prog(gpt.compile(file));
+
+    std::string input;
+    for (int i = 0; i < 20000; i++)
+        input += "k" + std::string(1 + i % 5, 'a') + " = " + std::to_string(i) + "\n";
+
+    CodeTracker engineTrckr(&input);
+    CodeTracker vmTrckr(&input);
+    ParseResult* engine = gpt.parse(file, &engineTrckr);
+    ParseResult* vm = prog->parse(&vmTrckr);
+
+    expect(!engine->mError && !vm->mError, "large input parses both ways");
+    if (!engine->mError && !vm->mError) {
+        expect(vm->mNode->mNodes.size() == 20000, "large input gives every line");
+        expect(sameTree(*engine->mNode, *vm->mNode), "large input gives the same tree");
+    }
+
+    delete engine;
+    delete vm;
+}
+
+int main() {
+    testRandomInputs();
+    testLargeInput();
+
+    if (failures == 0)
+        std::printf("vm_test: ok\n");
+
+    return failures == 0 ? 0 : 1;
+}
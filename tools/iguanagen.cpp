@@ -0,0 +1,47 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "constructor.h"
+
+// Usage: iguanagen <grammar file> <name> [output dir]
+//
+// Writes <name>.h and <name>.cpp, which define <name>::parse for the
+// grammar's ROOT production. Compile the source against the Iguana headers.
+int main(int argc, char** argv) {
+    if (argc < 3 || argc > 4) {
+        std::fprintf(stderr, "Usage: %s <grammar file> <name> [output dir]\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream in(argv[1]);
+    if (!in) {
+        std::fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::ostringstream grammar;
+    grammar << in.rdbuf();
+
+    std::string name = argv[2];
+    auto res = IguanaConstructor::generate(grammar.str(), name);
+
+    if (res.mIsError) {
+        std::fprintf(stderr, "%s\n", res.mErrorMsg.c_str());
+        return 1;
+    }
+
+    std::string dir = argc == 4 ? std::string(argv[3]) + "/" : "";
+
+    std::ofstream header(dir + name + ".h");
+    std::ofstream source(dir + name + ".cpp");
+    header << res.mHeader;
+    source << res.mSource;
+
+    if (!header || !source) {
+        std::fprintf(stderr, "Could not write %s%s.h/.cpp\n", dir.c_str(), name.c_str());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstdio>
+#include <regex>
+#include <string>
+#include <vector>
+#include "compiledregex.h"
+#include "iguana.h"
+
+// Usage: regexbench [bytes]
+//
+// Times token regexes matched by CompiledRegex against std::regex with
+// match_continuous, and a Many of Regex parsers run through the engine.
+
+using namespace Iguana;
+
+static double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    std::size_t bytes = argc > 1 ? std::stoul(argv[1]) : 1 << 20;
+
+    std::string input;
+    while (input.size() < bytes)
+        input += "alpha_1 = 0x1f + 42 * beta \"str\\\"ing\" 3.25 ";
+
+    const std::vector<std::string> patterns = {
+        "[a-z_][a-z0-9_]*", "0x[0-9a-f]+|[0-9]+", "\\d+\\.\\d*", "\"([^\"\\\\]|\\\\.)*\"", "\\s+",
+    };
+
+    std::printf("%-24s %10s %10s %8s\n", "pattern", "std ms", "native ms", "speedup");
+
+    for (const std::string& pattern : patterns) {
+        CompiledRegex compiled(pattern);
+        std::regex reference(pattern);
+        const char* end = input.data() + input.size();
+
+        // Try the pattern at every offset, as a parser would while
+        // backtracking, and count the matches so neither loop is elided.
+        std::size_t stdMatches = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const char* p = input.data(); p != end; ++p) {
+            std::cmatch m;
+            if (std::regex_search(p, end, m, reference, std::regex_constants::match_continuous))
+                stdMatches++;
+        }
+        double stdMs = millisSince(start);
+
+        std::size_t nativeMatches = 0;
+        start = std::chrono::steady_clock::now();
+        for (const char* p = input.data(); p != end; ++p) {
+            if (compiled.match(p, end) != CompiledRegex::npos)
+                nativeMatches++;
+        }
+        double nativeMs = millisSince(start);
+
+        std::printf("%-24s %10.1f %10.1f %7.1fx%s\n", pattern.c_str(), stdMs, nativeMs, stdMs / nativeMs,
+            stdMatches == nativeMatches ? "" : "  (match counts differ)");
+    }
+
+    GlobalParserTable gpt;
+    Parser* token = gpt.Or("token", {
+        gpt.Regex("hex", "0x[0-9a-f]+"),
+        gpt.Regex("float", "\\d+\\.\\d*"),
+        gpt.Regex("int", "[0-9]+"),
+        gpt.Regex("ident", "[a-z_][a-z0-9_]*"),
+        gpt.Regex("string", "\"([^\"\\\\]|\\\\.)*\""),
+        gpt.Regex("op", "[-+*=]"),
+    });
+    Parser* root = gpt.Many("root", token);
+
+    CodeTracker trckr(&input);
+    auto start = std::chrono::steady_clock::now();
+    ParseResult* res = gpt.parse(root, &trckr);
+    double parseMs = millisSince(start);
+
+    std::printf("engine: %zu tokens in %.1f ms (%.1f MB/s)\n",
+        res->mError ? 0 : res->mNode->mNodes.size(), parseMs, input.size() / parseMs / 1000.0);
+    delete res;
+
+    return 0;
+}
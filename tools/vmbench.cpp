@@ -0,0 +1,66 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "iguana.h"
+#include "codetracker.h"
+#include "vm.h"
+
+// Usage: vmbench [lines] [rounds]
+//
+// Times an expression grammar parsed by GlobalParserTable::parse against
+// the same grammar compiled to a Program, on one generated input.
+
+using namespace Iguana;
+
+static double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    std::size_t lines = argc > 1 ? std::stoul(argv[1]) : 100000;
+    int rounds = argc > 2 ? std::stoi(argv[2]) : 3;
+
+    GlobalParserTable gpt;
+    Parser* expr = gpt.Empty("expr");
+    Parser* atom = gpt.Or("atom", {
+        gpt.Digit("num"),
+        gpt.Alphabetic("id"),
+        gpt.And("paren", { gpt.String("lp", "("), expr, gpt.String("rp", ")") }),
+    });
+    Parser* sum = gpt.And("sum", { atom, gpt.String("plus", "+"), expr });
+    Parser* body = Parser::Or({ sum, atom }, "expr");
+    gpt.assign(expr, body);
+    delete body;
+    Parser* root = gpt.Many("root", expr);
+
+    std::unique_ptr<Program> prog(gpt.compile(root));
+
+    std::string input;
+    for (std::size_t i = 0; i < lines; i++)
+        input += "( abc + " + std::to_string(i * 7 % 1000) + " ) + b\n";
+
+    std::printf("%zu bytes, %zu instructions\n", input.size(), prog->size());
+    std::printf("%-6s %10s %10s %8s\n", "round", "engine ms", "vm ms", "speedup");
+
+    for (int round = 0; round < rounds; round++) {
+        CodeTracker engineTrckr(&input);
+        auto start = std::chrono::steady_clock::now();
+        ParseResult* engine = gpt.parse(root, &engineTrckr);
+        double engineMs = millisSince(start);
+
+        CodeTracker vmTrckr(&input);
+        start = std::chrono::steady_clock::now();
+        ParseResult* vm = prog->parse(&vmTrckr);
+        double vmMs = millisSince(start);
+
+        bool same = !engine->mError && !vm->mError && engine->mNode->mNodes.size() == vm->mNode->mNodes.size();
+        std::printf("%-6d %10.1f %10.1f %7.1fx%s\n", round, engineMs, vmMs, engineMs / vmMs,
+            same ? "" : "  (results differ)");
+
+        delete engine;
+        delete vm;
+    }
+
+    return 0;
+}